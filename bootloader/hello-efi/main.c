@@ -4,6 +4,7 @@
 #include <stddef.h>
 
 #include "aios/bootinfo.h"
+#include "aios/crc32c.h"
 
 #define KERNEL_PATH L"\\AIOS\\KERNEL.ELF"
 #define FS_IMAGE_PATH L"\\AIOS\\FS.IMG"
@@ -40,7 +41,15 @@ static VOID summarize_memory(const struct memory_map *map, struct aios_memory_su
 static UINT32 checksum_bootinfo(const struct aios_boot_info *boot);
 static VOID free_memory_map(struct memory_map *map);
 
+static inline UINT64 read_tsc(void) {
+    UINT32 lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((UINT64)hi << 32) | lo;
+}
+
 EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_table) {
+    struct aios_boot_timeline timeline = {0};
+    timeline.tsc[AIOS_PHASE_LOADER_ENTRY] = read_tsc();
     InitializeLib(image_handle, system_table);
 
     Print(L"[loader] Firmware -> Loader -> Kernel -> [paging soon]\r\n");
@@ -52,6 +61,7 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_tab
         Print(L"Failed to open filesystem: %r\r\n", status);
         return status;
     }
+    timeline.tsc[AIOS_PHASE_OPEN_ROOT] = read_tsc();
 
     VOID *kernel_file = NULL;
     UINTN kernel_size = 0;
@@ -60,6 +70,7 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_tab
         Print(L"Unable to read %s: %r\r\n", KERNEL_PATH, status);
         return status;
     }
+    timeline.tsc[AIOS_PHASE_KERNEL_READ] = read_tsc();
     Print(L"[loader] Stage: kernel image loaded (%u bytes)\r\n", (UINT32)kernel_size);
 
     struct loaded_kernel kernel = {0};
@@ -69,6 +80,7 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_tab
         Print(L"ELF load failed: %r\r\n", status);
         return status;
     }
+    timeline.tsc[AIOS_PHASE_ELF_LOAD] = read_tsc();
 
     struct aios_boot_info boot = {
         .magic = AIOS_BOOTINFO_MAGIC,
@@ -96,6 +108,7 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_tab
     } else {
         Print(L"[loader] FS image missing; kernel will format RAM FS\r\n");
     }
+    timeline.tsc[AIOS_PHASE_FS_IMAGE] = read_tsc();
 
     query_framebuffer(&boot.framebuffer);
     describe_boot_device(image_handle, &boot.boot_device);
@@ -114,9 +127,11 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_tab
         boot.memory_map.descriptor_size = map.descriptor_size;
         boot.memory_map.descriptor_version = map.descriptor_version;
         summarize_memory(&map, &boot.memory_summary);
+        timeline.tsc[AIOS_PHASE_MEMORY_MAP] = read_tsc();
 
         status = exit_boot_services_with_map(image_handle, &map);
         if (status == EFI_SUCCESS) {
+            timeline.tsc[AIOS_PHASE_EXIT_BOOT_SERVICES] = read_tsc();
             break;
         }
         if (status != EFI_INVALID_PARAMETER) {
@@ -127,6 +142,7 @@ EFI_STATUS EFIAPI efi_main(EFI_HANDLE image_handle, EFI_SYSTEM_TABLE *system_tab
         /* Memory map changed between calls. Retry. */
     }
 
+    boot.timeline = timeline;
     boot.checksum = checksum_bootinfo(&boot);
     /* Cannot use Print after ExitBootServices on all firmware reliably; we already logged before. */
     typedef void (*kernel_entry_t)(struct aios_boot_info *);
@@ -424,13 +440,7 @@ static UINT32 checksum_bootinfo(const struct aios_boot_info *boot) {
     struct aios_boot_info tmp;
     CopyMem(&tmp, boot, sizeof tmp);
     tmp.checksum = 0;
-    UINT32 sum = 0;
-    const UINT32 *words = (const UINT32 *)&tmp;
-    size_t count = sizeof(tmp) / sizeof(UINT32);
-    for (size_t i = 0; i < count; ++i) {
-        sum ^= words[i];
-    }
-    return sum;
+    return aios_crc32c_sw(0, &tmp, sizeof(tmp));
 }
 
 static VOID free_memory_map(struct memory_map *map) {
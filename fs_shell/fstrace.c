@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+#include "fstrace.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *const kind_names[FSTRACE_KINDS] = {
+    [FSTRACE_MKDIR] = "mkdir",
+    [FSTRACE_WRITE] = "write",
+    [FSTRACE_READ] = "read",
+    [FSTRACE_DELETE] = "delete",
+    [FSTRACE_LIST] = "list",
+};
+
+const char *fstrace_kind_name(enum fstrace_kind kind) {
+    return kind < FSTRACE_KINDS ? kind_names[kind] : "?";
+}
+
+uint64_t fstrace_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void fstrace_begin(FILE *out) {
+    fprintf(out, "#fstrace v1\n");
+}
+
+void fstrace_write(FILE *out, const struct fstrace_op *op) {
+    fprintf(out, "%s %s %" PRIu32 " %" PRIu32 " %d %" PRIu64 "\n", fstrace_kind_name(op->kind),
+            op->path[0] ? op->path : ".", op->offset, op->length, op->result, op->ns);
+}
+
+void fstrace_end(FILE *out) {
+    fprintf(out, "#end\n");
+    fflush(out);
+}
+
+static int parse_line(const char *line, struct fstrace_op *op) {
+    char kind[16];
+    char fmt[64];
+    long long result;
+    unsigned long long offset, length, ns;
+    snprintf(fmt, sizeof(fmt), "%%15s %%%ds %%llu %%llu %%lld %%llu", FSTRACE_PATH_MAX - 1);
+    if (sscanf(line, fmt, kind, op->path, &offset, &length, &result, &ns) != 6) {
+        return -1;
+    }
+    for (int k = 0; k < FSTRACE_KINDS; ++k) {
+        if (strcmp(kind, kind_names[k]) == 0) {
+            op->kind = (enum fstrace_kind)k;
+            op->offset = (uint32_t)offset;
+            op->length = (uint32_t)length;
+            op->result = result < 0 ? -1 : 0;
+            op->ns = ns;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int fstrace_load(const char *path, struct fstrace_op **out_ops, size_t *out_count) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    struct fstrace_op *ops = NULL;
+    size_t count = 0, cap = 0;
+    int in_trace = 0, seen = 0;
+    char line[FSTRACE_PATH_MAX + 128];
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "#fstrace", 8) == 0) {
+            in_trace = seen = 1;
+            continue;
+        }
+        if (!in_trace) continue;
+        if (strncmp(line, "#end", 4) == 0) break;
+        if (line[0] == '#') continue;
+        if (count == cap) {
+            cap = cap ? cap * 2 : 256;
+            struct fstrace_op *tmp = realloc(ops, cap * sizeof(*ops));
+            if (!tmp) {
+                free(ops);
+                fclose(f);
+                return -1;
+            }
+            ops = tmp;
+        }
+        if (parse_line(line, &ops[count]) == 0) count++;
+    }
+    fclose(f);
+    if (!seen) {
+        free(ops);
+        return -1;
+    }
+    *out_ops = ops;
+    *out_count = count;
+    return 0;
+}
+
+void fstrace_account(struct fstrace_stats *stats, const struct fstrace_op *op, int result, uint64_t ns) {
+    stats->count[op->kind]++;
+    stats->recorded_ns[op->kind] += op->ns;
+    stats->replay_ns[op->kind] += ns;
+    if ((result < 0) != (op->result < 0)) {
+        stats->mismatches++;
+    }
+}
+
+void fstrace_print(const struct fstrace_stats *stats, uint64_t wall_ns) {
+    uint64_t total = 0;
+    printf("%-8s %8s %14s %14s\n", "op", "count", "recorded ns/op", "replay ns/op");
+    for (int k = 0; k < FSTRACE_KINDS; ++k) {
+        uint64_t n = stats->count[k];
+        if (!n) continue;
+        total += n;
+        printf("%-8s %8" PRIu64 " %14" PRIu64 " %14" PRIu64 "\n", kind_names[k], n,
+               stats->recorded_ns[k] / n, stats->replay_ns[k] / n);
+    }
+    printf("%" PRIu64 " ops in %" PRIu64 " us", total, wall_ns / 1000u);
+    if (wall_ns) {
+        printf(" (%" PRIu64 " ops/s)", total * 1000000000u / wall_ns);
+    }
+    printf(", %" PRIu64 " result mismatches\n", stats->mismatches);
+}
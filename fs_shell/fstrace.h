@@ -0,0 +1,64 @@
+#ifndef AIOS_FSTRACE_H
+#define AIOS_FSTRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Filesystem workload traces, shared by fs_shell and the kernel shell's
+ * `record` command. One text line per operation between a header and a
+ * terminator:
+ *
+ *   #fstrace v1 [key=value ...]
+ *   <op> <path> <offset> <length> <result> <duration_ns>
+ *   #end
+ *
+ * op is mkdir, write, read, delete or list. path is relative to the fs
+ * root ("." for the root) and has no spaces. length is bytes written/read,
+ * or entries for list; result is 0 or -1. Anything outside the header and
+ * terminator (for example the rest of a serial log) is ignored on load.
+ */
+
+#define FSTRACE_PATH_MAX 512
+
+enum fstrace_kind {
+    FSTRACE_MKDIR,
+    FSTRACE_WRITE,
+    FSTRACE_READ,
+    FSTRACE_DELETE,
+    FSTRACE_LIST,
+    FSTRACE_KINDS
+};
+
+struct fstrace_op {
+    enum fstrace_kind kind;
+    char path[FSTRACE_PATH_MAX];
+    uint32_t offset;
+    uint32_t length;
+    int result;
+    uint64_t ns;
+};
+
+/* Per-kind totals for one replay. */
+struct fstrace_stats {
+    uint64_t count[FSTRACE_KINDS];
+    uint64_t recorded_ns[FSTRACE_KINDS];
+    uint64_t replay_ns[FSTRACE_KINDS];
+    uint64_t mismatches; /* replay result differs from the recorded one */
+};
+
+const char *fstrace_kind_name(enum fstrace_kind kind);
+uint64_t fstrace_now_ns(void);
+
+void fstrace_begin(FILE *out);
+void fstrace_write(FILE *out, const struct fstrace_op *op);
+void fstrace_end(FILE *out);
+
+/* Loads the first trace in the file; caller free()s *out_ops. */
+int fstrace_load(const char *path, struct fstrace_op **out_ops, size_t *out_count);
+
+void fstrace_account(struct fstrace_stats *stats, const struct fstrace_op *op, int result, uint64_t ns);
+void fstrace_print(const struct fstrace_stats *stats, uint64_t wall_ns);
+
+#endif /* AIOS_FSTRACE_H */
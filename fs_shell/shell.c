@@ -6,6 +6,7 @@
 #include <ctype.h>
 
 #include "fs.h"
+#include "fstrace.h"
 
 #define DEFAULT_IMAGE "fs_image.img"
 #define DEFAULT_BLOCKS 1024u      /* 4 MiB at 4096-byte blocks */
@@ -17,6 +18,7 @@ struct shell_state {
     uint32_t cwd_inode;
     char cwd_path[FS_MAX_PATH];
     int mounted;
+    FILE *record; /* open while `record` is on */
 };
 
 static void trim_newline(char *s) {
@@ -82,6 +84,17 @@ static int normalize_path(const char *cwd, const char *input, char *out) {
     return 0;
 }
 
+/* Appends one timed operation (started at t0) to the open recording. */
+static void record_op(struct shell_state *sh, enum fstrace_kind kind, const char *path, uint32_t length, int result, uint64_t t0) {
+    uint64_t ns = fstrace_now_ns() - t0;
+    if (!sh->record) return;
+    char abs[FS_MAX_PATH];
+    if (normalize_path(sh->cwd_path, path, abs) != 0) return;
+    struct fstrace_op op = {.kind = kind, .length = length, .result = result, .ns = ns};
+    strcpy(op.path, abs + 1); /* relative to the root; "" prints as "." */
+    fstrace_write(sh->record, &op);
+}
+
 static void print_help(void) {
     printf("Commands:\n");
     printf("  list [path]      - list directory contents\n");
@@ -93,6 +106,8 @@ static void print_help(void) {
     printf("  pwd              - print working directory\n");
     printf("  format           - format current image (destructive)\n");
     printf("  mount <image>    - mount a different image (formats if missing)\n");
+    printf("  record <file>    - log file operations to a trace; 'record stop' ends it\n");
+    printf("  replay <file>    - run a trace against this image as fast as possible\n");
     printf("  help             - show this help\n");
     printf("  exit             - quit shell\n");
 }
@@ -120,7 +135,10 @@ static int cmd_list(struct shell_state *sh, const char *arg) {
     const char *path = arg ? arg : ".";
     struct fs_dirent_disk *entries = NULL;
     size_t count = 0;
-    if (fs_list_dir(&sh->fs, sh->cwd_inode, path, &entries, &count) != 0) {
+    uint64_t t0 = fstrace_now_ns();
+    int rc = fs_list_dir(&sh->fs, sh->cwd_inode, path, &entries, &count);
+    record_op(sh, FSTRACE_LIST, path, (uint32_t)count, rc, t0);
+    if (rc != 0) {
         printf("list: failed\n");
         return -1;
     }
@@ -134,7 +152,10 @@ static int cmd_list(struct shell_state *sh, const char *arg) {
 static int cmd_mkdir(struct shell_state *sh, const char *arg) {
     if (!arg) { printf("make-dir: missing path\n"); return -1; }
     if (ensure_mounted(sh) != 0) return -1;
-    if (fs_make_dir(&sh->fs, sh->cwd_inode, arg) != 0) {
+    uint64_t t0 = fstrace_now_ns();
+    int rc = fs_make_dir(&sh->fs, sh->cwd_inode, arg);
+    record_op(sh, FSTRACE_MKDIR, arg, 0, rc, t0);
+    if (rc != 0) {
         printf("make-dir: failed\n");
         return -1;
     }
@@ -144,7 +165,10 @@ static int cmd_mkdir(struct shell_state *sh, const char *arg) {
 static int cmd_delete(struct shell_state *sh, const char *arg) {
     if (!arg) { printf("delete: missing path\n"); return -1; }
     if (ensure_mounted(sh) != 0) return -1;
-    if (fs_delete(&sh->fs, sh->cwd_inode, arg) != 0) {
+    uint64_t t0 = fstrace_now_ns();
+    int rc = fs_delete(&sh->fs, sh->cwd_inode, arg);
+    record_op(sh, FSTRACE_DELETE, arg, 0, rc, t0);
+    if (rc != 0) {
         printf("delete: failed (directory not empty or not found)\n");
         return -1;
     }
@@ -166,10 +190,6 @@ static int ensure_file_exists(struct shell_state *sh, const char *path) {
 static int cmd_write(struct shell_state *sh, const char *arg) {
     if (!arg) { printf("write: missing path\n"); return -1; }
     if (ensure_mounted(sh) != 0) return -1;
-    if (ensure_file_exists(sh, arg) != 0) {
-        printf("write: failed to create file\n");
-        return -1;
-    }
     printf("Enter content, end with Ctrl-D (EOF):\n");
     char *line = NULL;
     size_t cap = 0;
@@ -189,7 +209,17 @@ static int cmd_write(struct shell_state *sh, const char *arg) {
         total += (size_t)n;
     }
     free(line);
-    if (fs_write_file(&sh->fs, sh->cwd_inode, arg, (uint8_t *)buf, total, 0) != 0) {
+    /* Timed like the kernel recorder and the replayers: create + write. */
+    uint64_t t0 = fstrace_now_ns();
+    if (ensure_file_exists(sh, arg) != 0) {
+        record_op(sh, FSTRACE_WRITE, arg, (uint32_t)total, -1, t0);
+        printf("write: failed to create file\n");
+        free(buf);
+        return -1;
+    }
+    int rc = fs_write_file(&sh->fs, sh->cwd_inode, arg, (uint8_t *)buf, total, 0);
+    record_op(sh, FSTRACE_WRITE, arg, (uint32_t)total, rc, t0);
+    if (rc != 0) {
         printf("write: failed to write data\n");
         free(buf);
         return -1;
@@ -203,7 +233,9 @@ static int cmd_read(struct shell_state *sh, const char *arg) {
     if (ensure_mounted(sh) != 0) return -1;
     uint32_t ino;
     struct fs_inode node;
+    uint64_t t0 = fstrace_now_ns();
     if (fs_lookup(&sh->fs, sh->cwd_inode, arg, &node, &ino) != 0 || node.type != FS_INODE_FILE) {
+        record_op(sh, FSTRACE_READ, arg, 0, -1, t0);
         printf("read: not found or not a file\n");
         return -1;
     }
@@ -211,7 +243,9 @@ static int cmd_read(struct shell_state *sh, const char *arg) {
     uint8_t *buf = malloc(len + 1);
     if (!buf) return -1;
     size_t got = 0;
-    if (fs_read_file(&sh->fs, sh->cwd_inode, arg, buf, len, 0, &got) != 0) {
+    int rc = fs_read_file(&sh->fs, sh->cwd_inode, arg, buf, len, 0, &got);
+    record_op(sh, FSTRACE_READ, arg, (uint32_t)got, rc, t0);
+    if (rc != 0) {
         printf("read: failed\n");
         free(buf);
         return -1;
@@ -285,6 +319,87 @@ static int cmd_mount(struct shell_state *sh, const char *arg) {
     return 0;
 }
 
+static int cmd_record(struct shell_state *sh, const char *arg) {
+    if (!arg) { printf("record: missing trace path (or 'stop')\n"); return -1; }
+    if (sh->record) {
+        fstrace_end(sh->record);
+        fclose(sh->record);
+        sh->record = NULL;
+        printf("record: stopped\n");
+    }
+    if (strcmp(arg, "stop") == 0) return 0;
+    sh->record = fopen(arg, "w");
+    if (!sh->record) {
+        printf("record: cannot open %s: %s\n", arg, strerror(errno));
+        return -1;
+    }
+    fstrace_begin(sh->record);
+    printf("record: logging file operations to %s\n", arg);
+    return 0;
+}
+
+/* Replays a trace from the root directory; file contents are synthetic. */
+static int replay_op(struct shell_state *sh, const struct fstrace_op *op, uint8_t *buf, size_t buf_len) {
+    uint32_t root = fs_root_inode(&sh->fs);
+    switch (op->kind) {
+    case FSTRACE_MKDIR:
+        return fs_make_dir(&sh->fs, root, op->path);
+    case FSTRACE_DELETE:
+        return fs_delete(&sh->fs, root, op->path);
+    case FSTRACE_WRITE: {
+        struct fs_inode node;
+        uint32_t ino;
+        if (fs_lookup(&sh->fs, root, op->path, &node, &ino) != 0 && fs_create_file(&sh->fs, root, op->path) != 0) {
+            return -1;
+        }
+        size_t len = op->length < buf_len ? op->length : buf_len;
+        return fs_write_file(&sh->fs, root, op->path, buf, len, op->offset);
+    }
+    case FSTRACE_READ: {
+        size_t got = 0;
+        size_t len = op->length < buf_len ? op->length : buf_len;
+        return fs_read_file(&sh->fs, root, op->path, buf, len, op->offset, &got);
+    }
+    case FSTRACE_LIST: {
+        struct fs_dirent_disk *entries = NULL;
+        size_t count = 0;
+        if (fs_list_dir(&sh->fs, root, op->path, &entries, &count) != 0) return -1;
+        free(entries);
+        return 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+static int cmd_replay(struct shell_state *sh, const char *arg) {
+    if (!arg) { printf("replay: missing trace path\n"); return -1; }
+    if (ensure_mounted(sh) != 0) return -1;
+    struct fstrace_op *ops = NULL;
+    size_t count = 0;
+    if (fstrace_load(arg, &ops, &count) != 0) {
+        printf("replay: no trace found in %s\n", arg);
+        return -1;
+    }
+    size_t buf_len = (size_t)FS_DIRECT_BLOCKS * sh->fs.sb.block_size;
+    uint8_t *buf = malloc(buf_len);
+    if (!buf) { free(ops); return -1; }
+    for (size_t i = 0; i < buf_len; ++i) buf[i] = (uint8_t)('a' + i % 26u);
+
+    struct fstrace_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    uint64_t start = fstrace_now_ns();
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t t0 = fstrace_now_ns();
+        int rc = replay_op(sh, &ops[i], buf, buf_len);
+        fstrace_account(&stats, &ops[i], rc, fstrace_now_ns() - t0);
+    }
+    fstrace_print(&stats, fstrace_now_ns() - start);
+    free(buf);
+    free(ops);
+    return 0;
+}
+
 static void dispatch(struct shell_state *sh, char *line) {
     trim_newline(line);
     char *cmd = strtok(line, " \t");
@@ -301,7 +416,10 @@ static void dispatch(struct shell_state *sh, char *line) {
     if (strcmp(cmd, "pwd") == 0) { cmd_pwd(sh); return; }
     if (strcmp(cmd, "format") == 0) { cmd_format(sh); return; }
     if (strcmp(cmd, "mount") == 0) { cmd_mount(sh, arg); return; }
+    if (strcmp(cmd, "record") == 0) { cmd_record(sh, arg); return; }
+    if (strcmp(cmd, "replay") == 0) { cmd_replay(sh, arg); return; }
     if (strcmp(cmd, "exit") == 0 || strcmp(cmd, "quit") == 0) {
+        if (sh->record) cmd_record(sh, "stop");
         fs_unmount(&sh->fs);
         exit(0);
     }
@@ -331,6 +449,7 @@ int main(int argc, char **argv) {
         }
         dispatch(&sh, line);
     }
+    if (sh.record) cmd_record(&sh, "stop");
     fs_unmount(&sh.fs);
     free(line);
     return 0;
@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "fstrace.h"
+#include "hist.h"
+#include "mem.h"
+#include "pmm.h"
+
+#define DEFAULT_DISK_MIB 16u
+#define DEFAULT_INODES 256u  /* same as the kernel's RAM FS */
+#define HEAP_BYTES (8u << 20)
+
+static void *heap_grow(size_t min_bytes, size_t *out_bytes) {
+    size_t want = HEAP_BYTES;
+    while (want < min_bytes) want <<= 1;
+    void *region = aligned_alloc(PAGE_SIZE, want);
+    if (region) *out_bytes = want;
+    return region;
+}
+
+/* Mirrors fs_shell's replay: paths are relative to the root, contents synthetic. */
+static int replay_op(fs_t *fs, const struct fstrace_op *op, uint8_t *buf, size_t buf_len) {
+    uint32_t root = fs_root_inode(fs);
+    switch (op->kind) {
+    case FSTRACE_MKDIR:
+        return fs_make_dir(fs, root, op->path);
+    case FSTRACE_DELETE:
+        return fs_delete(fs, root, op->path);
+    case FSTRACE_WRITE: {
+        if (fs_lookup(fs, root, op->path, NULL, NULL) != 0 && fs_create_file(fs, root, op->path) != 0) {
+            return -1;
+        }
+        size_t len = op->length < buf_len ? op->length : buf_len;
+        return fs_write_file(fs, root, op->path, buf, len, op->offset);
+    }
+    case FSTRACE_READ: {
+        size_t got = 0;
+        size_t len = op->length < buf_len ? op->length : buf_len;
+        return fs_read_file(fs, root, op->path, buf, len, op->offset, &got);
+    }
+    case FSTRACE_LIST: {
+        struct fs_dirent_disk *entries;
+        size_t count;
+        if (fs_list_dir(fs, root, op->path, &entries, &count) != 0) return -1;
+        kfree(entries);
+        return 0;
+    }
+    default:
+        return -1;
+    }
+}
+
+static int replay(struct storage_state *storage, const char *path, unsigned rounds) {
+    struct fstrace_op *ops = NULL;
+    size_t count = 0;
+    if (fstrace_load(path, &ops, &count) != 0) {
+        fprintf(stderr, "no trace found in %s\n", path);
+        return 1;
+    }
+    size_t buf_len = (size_t)FS_DIRECT_BLOCKS * FS_DEFAULT_BLOCK_SIZE;
+    uint8_t *buf = malloc(buf_len);
+    if (!buf) {
+        free(ops);
+        return 1;
+    }
+    for (size_t i = 0; i < buf_len; ++i) buf[i] = (uint8_t)('a' + i % 26u);
+
+    /* Each round starts from an empty filesystem, like the recording did. */
+    for (unsigned r = 0; r < rounds; ++r) {
+        if (r > 0 && (fs_format(&storage->fs, &storage->ram_dev, DEFAULT_INODES) != 0 ||
+                      fs_mount(&storage->fs, &storage->ram_dev) != 0)) {
+            fprintf(stderr, "RAM filesystem setup failed\n");
+            break;
+        }
+        struct fstrace_stats stats;
+        memset(&stats, 0, sizeof(stats));
+        uint64_t start = fstrace_now_ns();
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t t0 = fstrace_now_ns();
+            int rc = replay_op(&storage->fs, &ops[i], buf, buf_len);
+            fstrace_account(&stats, &ops[i], rc, fstrace_now_ns() - t0);
+        }
+        uint64_t wall = fstrace_now_ns() - start;
+        if (rounds > 1) printf("round %u/%u\n", r + 1, rounds);
+        fstrace_print(&stats, wall);
+    }
+    free(buf);
+    free(ops);
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [-d disk_mib] [-r rounds] [-l] [-t trace] [all|fs|io|heap|memcpy] [files]\n"
+            "  -d  RAM disk size in MiB (default %u)\n"
+            "  -r  repeat the workload; useful under perf record (default 1)\n"
+            "  -t  replay an fstrace (fs_shell record / kernel record dump) instead\n"
+            "  -l  print block device latency histograms afterwards\n",
+            argv0, DEFAULT_DISK_MIB);
+}
+
+int main(int argc, char **argv) {
+    unsigned disk_mib = DEFAULT_DISK_MIB;
+    unsigned rounds = 1;
+    int latency = 0;
+    const char *trace = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:r:lt:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            disk_mib = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            rounds = (unsigned)strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            latency = 1;
+            break;
+        case 't':
+            trace = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (disk_mib == 0 || disk_mib > 1024 || rounds == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    void *heap = aligned_alloc(PAGE_SIZE, HEAP_BYTES);
+    uint32_t disk_bytes = disk_mib << 20;
+    void *disk = aligned_alloc(PAGE_SIZE, disk_bytes);
+    if (!heap || !disk) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    memset(disk, 0, disk_bytes);
+    mem_init(heap, HEAP_BYTES);
+    mem_set_grow(heap_grow);
+
+    struct storage_state storage;
+    memset(&storage, 0, sizeof(storage));
+    if (bd_init_ram(&storage.ram_dev, disk, disk_bytes, FS_DEFAULT_BLOCK_SIZE) != 0 ||
+        fs_format(&storage.fs, &storage.ram_dev, DEFAULT_INODES) != 0 ||
+        fs_mount(&storage.fs, &storage.ram_dev) != 0) {
+        fprintf(stderr, "RAM filesystem setup failed\n");
+        return 1;
+    }
+    storage.active_dev = &storage.ram_dev;
+    storage.fs_ready = true;
+    storage.using_ram = true;
+    bd_stats_reset(&storage.ram_dev);
+
+    int rc = 0;
+    if (trace) {
+        rc = replay(&storage, trace, rounds);
+        goto done;
+    }
+
+    /* bench_run() takes the shell's argv: argv[0] is the command name. */
+    char *bench_argv[3] = {"bench", "all", NULL};
+    int bench_argc = 2;
+    if (optind < argc) bench_argv[1] = argv[optind];
+    if (optind + 1 < argc) bench_argv[bench_argc++] = argv[optind + 1];
+
+    for (unsigned i = 0; i < rounds; ++i) {
+        if (rounds > 1) printf("round %u/%u\n", i + 1, rounds);
+        bench_run(&storage, bench_argc, bench_argv);
+    }
+
+done:
+    if (latency) {
+        hist_print("bd read", &storage.ram_dev.stats->read_lat, 1);
+        hist_print("bd write", &storage.ram_dev.stats->write_lat, 1);
+    }
+    return rc;
+}
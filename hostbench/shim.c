@@ -0,0 +1,86 @@
+/*
+ * Host stand-ins for the kernel services that the filesystem, allocator and
+ * bench code call: console, clock, CPU features, the page allocator and
+ * preemption control (single-threaded here, so a no-op).
+ * String functions come from libc.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cpu.h"
+#include "pmm.h"
+#include "serial.h"
+#include "thread.h"
+#include "time.h"
+#include "util.h"
+
+/* Drops the \r of the kernel's \r\n line endings. */
+void serial_write(const char *str) {
+    for (; *str; ++str) {
+        if (*str != '\r') putchar(*str);
+    }
+}
+
+void serial_write_hex(uint64_t value) {
+    printf("%016llx", (unsigned long long)value);
+}
+
+void serial_write_u32(uint32_t value) {
+    printf("%u", value);
+}
+
+void serial_write_u64(uint64_t value) {
+    printf("%llu", (unsigned long long)value);
+}
+
+void preempt_disable(void) {
+}
+
+void preempt_enable(void) {
+}
+
+uint64_t ktime_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+const char *time_source_name(void) {
+    return "host monotonic";
+}
+
+void memzero_nt(void *dest, size_t n) {
+    memset(dest, 0, n);
+}
+
+const char *string_ops_name(void) {
+    return "libc";
+}
+
+static struct cpu_features features;
+
+const struct cpu_features *cpu_get_features(void) {
+    if (!features.vendor[0]) {
+        strcpy(features.vendor, "host");
+        features.sse42 = __builtin_cpu_supports("sse4.2");
+    }
+    return &features;
+}
+
+/* Naturally aligned, like the buddy allocator's blocks. */
+void *pmm_alloc_pages(unsigned order) {
+    return aligned_alloc((size_t)PAGE_SIZE << order, (size_t)PAGE_SIZE << order);
+}
+
+unsigned pmm_order_for(size_t bytes) {
+    unsigned order = 0;
+    while (order < PMM_MAX_ORDER && ((size_t)PAGE_SIZE << order) < bytes) order++;
+    return order;
+}
+
+void pmm_free_pages(void *addr, unsigned order) {
+    (void)order;
+    free(addr);
+}
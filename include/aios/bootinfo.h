@@ -4,7 +4,7 @@
 #include <stdint.h>
 
 #define AIOS_BOOTINFO_MAGIC 0x41494f53424f4f54ULL /* "AIOSBOOT" */
-#define AIOS_BOOTINFO_VERSION 1
+#define AIOS_BOOTINFO_VERSION 3 /* 2: CRC32C checksum, 3: loader timeline */
 
 struct aios_framebuffer {
     uint64_t base;
@@ -34,6 +34,22 @@ struct aios_block_device {
     char     label[16];
 };
 
+/* Raw TSC readings taken by the loader as each phase finishes. */
+enum aios_loader_phase {
+    AIOS_PHASE_LOADER_ENTRY,     /* efi_main reached */
+    AIOS_PHASE_OPEN_ROOT,        /* ESP filesystem opened */
+    AIOS_PHASE_KERNEL_READ,      /* KERNEL.ELF read into memory */
+    AIOS_PHASE_ELF_LOAD,         /* segments copied to their load address */
+    AIOS_PHASE_FS_IMAGE,         /* FS.IMG read (or found missing) */
+    AIOS_PHASE_MEMORY_MAP,       /* final GetMemoryMap */
+    AIOS_PHASE_EXIT_BOOT_SERVICES,
+    AIOS_LOADER_PHASES
+};
+
+struct aios_boot_timeline {
+    uint64_t tsc[AIOS_LOADER_PHASES]; /* 0 = not reached */
+};
+
 struct aios_boot_info {
     uint64_t magic;
     uint64_t version;
@@ -48,7 +64,8 @@ struct aios_boot_info {
     struct aios_memory_map memory_map;
     struct aios_memory_summary memory_summary;
     struct aios_block_device boot_device;
-    uint32_t checksum; /* simple XOR checksum over this struct with checksum set to 0 */
+    struct aios_boot_timeline timeline;
+    uint32_t checksum; /* CRC32C over this struct with checksum set to 0 (aios/crc32c.h) */
 };
 
 #endif /* AIOS_BOOTINFO_H */
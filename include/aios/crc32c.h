@@ -0,0 +1,57 @@
+#ifndef AIOS_CRC32C_H
+#define AIOS_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Portable CRC32C (Castagnoli, reflected polynomial 0x82F63B78), slicing by
+ * 8 bytes. Shared by the loader and the kernel's fallback path; the kernel
+ * uses the SSE4.2 crc32 instruction when it can. Pass 0 to start and the
+ * previous result to continue a running checksum.
+ */
+
+#define AIOS_CRC32C_POLY 0x82F63B78u
+
+static uint32_t aios_crc32c_table[8][256];
+static int aios_crc32c_table_ready;
+
+static inline void aios_crc32c_build_table(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (AIOS_CRC32C_POLY & (0u - (c & 1u)));
+        aios_crc32c_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = aios_crc32c_table[0][i];
+        for (int t = 1; t < 8; ++t) {
+            c = aios_crc32c_table[0][c & 0xFFu] ^ (c >> 8);
+            aios_crc32c_table[t][i] = c;
+        }
+    }
+    aios_crc32c_table_ready = 1;
+}
+
+static inline uint32_t aios_crc32c_sw(uint32_t crc, const void *data, size_t len) {
+    if (!aios_crc32c_table_ready) aios_crc32c_build_table();
+    const uint8_t *p = (const uint8_t *)data;
+    uint32_t c = ~crc;
+    while (len && ((uintptr_t)p & 7u)) {
+        c = aios_crc32c_table[0][(c ^ *p++) & 0xFFu] ^ (c >> 8);
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t lo = c ^ ((uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        uint32_t hi = (uint32_t)p[4] | (uint32_t)p[5] << 8 | (uint32_t)p[6] << 16 | (uint32_t)p[7] << 24;
+        c = aios_crc32c_table[7][lo & 0xFFu] ^ aios_crc32c_table[6][(lo >> 8) & 0xFFu] ^
+            aios_crc32c_table[5][(lo >> 16) & 0xFFu] ^ aios_crc32c_table[4][lo >> 24] ^
+            aios_crc32c_table[3][hi & 0xFFu] ^ aios_crc32c_table[2][(hi >> 8) & 0xFFu] ^
+            aios_crc32c_table[1][(hi >> 16) & 0xFFu] ^ aios_crc32c_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) c = aios_crc32c_table[0][(c ^ *p++) & 0xFFu] ^ (c >> 8);
+    return ~c;
+}
+
+#endif /* AIOS_CRC32C_H */
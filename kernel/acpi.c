@@ -0,0 +1,166 @@
+#include "acpi.h"
+#include "util.h"
+
+#define MADT_LOCAL_APIC       0
+#define MADT_IO_APIC          1
+#define MADT_SOURCE_OVERRIDE  2
+#define MADT_PCAT_COMPAT      1u
+#define LAPIC_ENABLED         1u
+
+struct acpi_rsdp {
+    char signature[8];
+    uint8_t checksum;
+    char oem[6];
+    uint8_t revision;
+    uint32_t rsdt_address;
+    uint32_t length;        /* revision 2+ */
+    uint64_t xsdt_address;
+    uint8_t ext_checksum;
+    uint8_t reserved[3];
+} __attribute__((packed));
+
+struct acpi_header {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem[6];
+    char oem_table[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed));
+
+struct madt {
+    struct acpi_header header;
+    uint32_t lapic_address;
+    uint32_t flags;
+} __attribute__((packed));
+
+struct madt_entry {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed));
+
+struct madt_local_apic {
+    struct madt_entry entry;
+    uint8_t processor_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed));
+
+struct madt_io_apic {
+    struct madt_entry entry;
+    uint8_t id;
+    uint8_t reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} __attribute__((packed));
+
+struct madt_override {
+    struct madt_entry entry;
+    uint8_t bus;
+    uint8_t source;
+    uint32_t gsi;
+    uint16_t flags;
+} __attribute__((packed));
+
+static struct acpi_info info;
+
+static int checksum_ok(const void *data, uint32_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; ++i) sum = (uint8_t)(sum + p[i]);
+    return sum == 0;
+}
+
+static const struct acpi_header *table_at(uint64_t addr, const char *signature) {
+    if (!addr) return 0;
+    const struct acpi_header *h = (const struct acpi_header *)(uintptr_t)addr;
+    if (memcmp(h->signature, signature, 4) != 0 || h->length < sizeof(*h)) return 0;
+    return checksum_ok(h, h->length) ? h : 0;
+}
+
+/* Walks the XSDT (64-bit entries) or RSDT (32-bit entries). */
+static const struct acpi_header *find_table(const struct acpi_header *root, int wide, const char *signature) {
+    uint32_t entry_size = wide ? 8u : 4u;
+    uint32_t count = (root->length - (uint32_t)sizeof(*root)) / entry_size;
+    const uint8_t *entries = (const uint8_t *)(root + 1);
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t addr = 0;
+        memcpy(&addr, entries + i * entry_size, entry_size);
+        const struct acpi_header *h = table_at(addr, signature);
+        if (h) return h;
+    }
+    return 0;
+}
+
+static void parse_madt(const struct madt *madt) {
+    info.madt_found = true;
+    info.lapic_address = madt->lapic_address;
+    info.legacy_pics = (madt->flags & MADT_PCAT_COMPAT) != 0;
+    const uint8_t *p = (const uint8_t *)(madt + 1);
+    const uint8_t *end = (const uint8_t *)madt + madt->header.length;
+    while (p + sizeof(struct madt_entry) <= end) {
+        const struct madt_entry *e = (const struct madt_entry *)p;
+        if (e->length < sizeof(*e) || p + e->length > end) break;
+        if (e->type == MADT_LOCAL_APIC && e->length >= sizeof(struct madt_local_apic)) {
+            const struct madt_local_apic *l = (const struct madt_local_apic *)e;
+            if (l->flags & LAPIC_ENABLED) info.cpu_count++;
+        } else if (e->type == MADT_IO_APIC && e->length >= sizeof(struct madt_io_apic)) {
+            const struct madt_io_apic *io = (const struct madt_io_apic *)e;
+            if (info.ioapic_count < ACPI_MAX_IOAPICS) {
+                struct acpi_ioapic *out = &info.ioapics[info.ioapic_count++];
+                out->id = io->id;
+                out->address = io->address;
+                out->gsi_base = io->gsi_base;
+            }
+        } else if (e->type == MADT_SOURCE_OVERRIDE && e->length >= sizeof(struct madt_override)) {
+            const struct madt_override *o = (const struct madt_override *)e;
+            if (o->bus == 0 && info.override_count < ACPI_MAX_OVERRIDES) {
+                struct acpi_override *out = &info.overrides[info.override_count++];
+                out->isa_irq = o->source;
+                out->gsi = o->gsi;
+                out->flags = o->flags;
+            }
+        }
+        p += e->length;
+    }
+}
+
+int acpi_init(uint64_t rsdp_address) {
+    memset(&info, 0, sizeof(info));
+    if (!rsdp_address) return -1;
+    const struct acpi_rsdp *rsdp = (const struct acpi_rsdp *)(uintptr_t)rsdp_address;
+    if (memcmp(rsdp->signature, "RSD PTR ", 8) != 0 || !checksum_ok(rsdp, 20)) return -1;
+    info.revision = rsdp->revision;
+    memcpy(info.oem, rsdp->oem, 6);
+    info.oem[6] = '\0';
+
+    const struct acpi_header *root = 0;
+    int wide = 0;
+    if (rsdp->revision >= 2 && checksum_ok(rsdp, rsdp->length)) {
+        root = table_at(rsdp->xsdt_address, "XSDT");
+        wide = root != 0;
+    }
+    if (!root) root = table_at(rsdp->rsdt_address, "RSDT");
+    if (!root) return -1;
+
+    const struct acpi_header *madt = find_table(root, wide, "APIC");
+    if (!madt || madt->length < sizeof(struct madt)) return -1;
+    parse_madt((const struct madt *)madt);
+    return 0;
+}
+
+const struct acpi_info *acpi_get_info(void) { return &info; }
+
+uint32_t acpi_isa_gsi(uint8_t isa_irq, uint16_t *flags) {
+    for (uint32_t i = 0; i < info.override_count; ++i) {
+        if (info.overrides[i].isa_irq == isa_irq) {
+            if (flags) *flags = info.overrides[i].flags;
+            return info.overrides[i].gsi;
+        }
+    }
+    if (flags) *flags = 0; /* ISA default: active high, edge */
+    return isa_irq;
+}
@@ -0,0 +1,52 @@
+#ifndef AIOS_KERNEL_ACPI_H
+#define AIOS_KERNEL_ACPI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ACPI_MAX_IOAPICS 4
+#define ACPI_MAX_OVERRIDES 16
+
+/* MPS INTI flags, as used by MADT interrupt source overrides. */
+#define ACPI_INTI_POLARITY_MASK 0x3u
+#define ACPI_INTI_ACTIVE_LOW    0x3u
+#define ACPI_INTI_TRIGGER_MASK  0xCu
+#define ACPI_INTI_LEVEL         0xCu
+
+struct acpi_ioapic {
+    uint8_t id;
+    uint32_t address;
+    uint32_t gsi_base;
+};
+
+struct acpi_override {
+    uint8_t isa_irq;
+    uint32_t gsi;
+    uint16_t flags; /* ACPI_INTI_* */
+};
+
+/* Interrupt topology from the MADT. */
+struct acpi_info {
+    bool madt_found;
+    bool legacy_pics;   /* PCAT_COMPAT: 8259s present and need masking */
+    uint8_t revision;   /* RSDP revision; 2+ means an XSDT */
+    char oem[7];
+    uint32_t lapic_address;
+    uint32_t cpu_count; /* enabled local APICs */
+    uint32_t ioapic_count;
+    struct acpi_ioapic ioapics[ACPI_MAX_IOAPICS];
+    uint32_t override_count;
+    struct acpi_override overrides[ACPI_MAX_OVERRIDES];
+};
+
+/*
+ * Validate the RSDP handed over by the loader and parse the MADT. The
+ * tables live in ACPI reclaim/NVS memory, which the kernel identity-maps
+ * and never reclaims.
+ */
+int acpi_init(uint64_t rsdp_address);
+const struct acpi_info *acpi_get_info(void);
+/* GSI for an ISA IRQ after source overrides; flags get the ACPI_INTI_* bits. */
+uint32_t acpi_isa_gsi(uint8_t isa_irq, uint16_t *flags);
+
+#endif
@@ -0,0 +1,49 @@
+#include "arena.h"
+#include "slab.h"
+
+#define ARENA_ALIGN 16u
+
+void arena_init(struct arena *a, struct slab_cache *source) {
+    a->source = source;
+    a->chunk_size = source ? source->obj_size : 0;
+    a->chunk_count = 0;
+    a->cur = 0;
+    a->offset = 0;
+    a->peak_chunks = 0;
+}
+
+void arena_destroy(struct arena *a) {
+    for (uint32_t i = 0; i < a->chunk_count; ++i) {
+        slab_free(a->source, a->chunks[i]);
+    }
+    arena_init(a, a->source);
+}
+
+void *arena_alloc(struct arena *a, size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) & ~((size_t)ARENA_ALIGN - 1);
+    if (!a->source || bytes == 0 || bytes > a->chunk_size) return NULL;
+    if (a->chunk_count > 0 && a->offset + bytes > a->chunk_size) {
+        if (a->cur + 1 >= ARENA_MAX_CHUNKS) return NULL;
+        a->cur++;
+        a->offset = 0;
+    }
+    if (a->cur >= a->chunk_count) {
+        uint8_t *chunk = (uint8_t *)slab_alloc(a->source);
+        if (!chunk) return NULL;
+        a->chunks[a->chunk_count++] = chunk;
+        a->offset = 0;
+    }
+    void *ptr = a->chunks[a->cur] + a->offset;
+    a->offset += bytes;
+    if (a->cur + 1 > a->peak_chunks) a->peak_chunks = a->cur + 1;
+    return ptr;
+}
+
+arena_mark_t arena_mark(const struct arena *a) {
+    return ((arena_mark_t)a->cur << 32) | (uint32_t)a->offset;
+}
+
+void arena_release(struct arena *a, arena_mark_t mark) {
+    a->cur = (uint32_t)(mark >> 32);
+    a->offset = (uint32_t)mark;
+}
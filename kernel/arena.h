@@ -0,0 +1,35 @@
+#ifndef AIOS_KERNEL_ARENA_H
+#define AIOS_KERNEL_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_MAX_CHUNKS 16
+
+struct slab_cache;
+
+/*
+ * Scratch arena: bump allocation out of chunks borrowed from a slab cache.
+ * Callers take a mark, allocate freely, then release back to the mark; a
+ * release is a position reset, and chunks stay with the arena for reuse
+ * until arena_destroy().
+ */
+struct arena {
+    struct slab_cache *source;
+    size_t chunk_size;
+    uint8_t *chunks[ARENA_MAX_CHUNKS];
+    uint32_t chunk_count;  /* chunks obtained from source */
+    uint32_t cur;          /* chunk being filled */
+    size_t offset;         /* bytes used in chunks[cur] */
+    uint32_t peak_chunks;  /* high-water mark of chunks in use */
+};
+
+typedef uint64_t arena_mark_t;
+
+void arena_init(struct arena *a, struct slab_cache *source);
+void arena_destroy(struct arena *a);
+void *arena_alloc(struct arena *a, size_t bytes);
+arena_mark_t arena_mark(const struct arena *a);
+void arena_release(struct arena *a, arena_mark_t mark);
+
+#endif
@@ -0,0 +1,258 @@
+#include "bench.h"
+#include "mem.h"
+#include "pmm.h"
+#include "serial.h"
+#include "time.h"
+#include "util.h"
+
+#define BENCH_DIR "bench.tmp" /* relative to the fs root */
+#define BENCH_FILE BENCH_DIR "/io"
+#define BENCH_DEFAULT_FILES 64u
+#define BENCH_MAX_FILES 96u      /* one directory block holds ~100 entries */
+#define BENCH_IO_BYTES (FS_DIRECT_BLOCKS * FS_DEFAULT_BLOCK_SIZE) /* largest file the fs supports */
+#define BENCH_IO_PASSES 16u
+#define BENCH_HEAP_OPS 100000u
+#define BENCH_HEAP_DEPTH 64u
+#define BENCH_COPY_ORDER 8       /* 1 MiB source and destination */
+#define BENCH_COPY_BYTES (64ull << 20) /* per size */
+
+static uint64_t rng_state;
+
+static void rng_seed(uint64_t seed) { rng_state = seed; }
+
+static uint32_t rng_next(void) {
+    /* xorshift64 */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static uint32_t parse_u32(const char *s, uint32_t fallback) {
+    if (!s || !*s) return fallback;
+    uint32_t v = 0;
+    for (; *s; ++s) {
+        if (*s < '0' || *s > '9') return fallback;
+        v = v * 10u + (uint32_t)(*s - '0');
+    }
+    return v;
+}
+
+static void file_name(char *out, uint32_t idx) {
+    char digits[12];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + idx % 10u);
+        idx /= 10u;
+    } while (idx);
+    strcpy(out, BENCH_DIR "/f");
+    size_t len = strlen(out);
+    while (n > 0) out[len++] = digits[--n];
+    out[len] = '\0';
+}
+
+/* One result line: name, ops, ns/op, ops/s and MiB/s when bytes moved. */
+static void report(const char *name, uint64_t ops, uint64_t ns, uint64_t bytes) {
+    serial_write("  ");
+    serial_write(name);
+    for (size_t i = strlen(name); i < 26; ++i) serial_write(" ");
+    if (ns == 0) ns = 1;
+    serial_write_u64(ops);
+    serial_write(" ops  ");
+    serial_write_u64(ops ? ns / ops : 0);
+    serial_write(" ns/op  ");
+    serial_write_u64(ops * NSEC_PER_SEC / ns);
+    serial_write(" ops/s");
+    if (bytes) {
+        serial_write("  ");
+        serial_write_u64((bytes * (NSEC_PER_SEC / 1024u) / ns) / 1024u);
+        serial_write(" MiB/s");
+    }
+    serial_write("\r\n");
+}
+
+static void bench_fs_meta(fs_t *fs, uint32_t root, uint32_t files) {
+    char path[FS_MAX_PATH];
+    struct fs_inode node;
+    uint32_t ino;
+    uint32_t done = 0;
+
+    uint64_t t0 = ktime_ns();
+    for (; done < files; ++done) {
+        file_name(path, done);
+        if (fs_create_file(fs, root, path) != 0) break;
+    }
+    report("fs create", done, ktime_ns() - t0, 0);
+    if (done < files) serial_write("  (create failed early; fs full?)\r\n");
+    if (done == 0) return;
+
+    rng_seed(0x5eed0001u);
+    uint32_t lookups = done * 16u;
+    t0 = ktime_ns();
+    for (uint32_t i = 0; i < lookups; ++i) {
+        file_name(path, rng_next() % done);
+        fs_lookup(fs, root, path, &node, &ino);
+    }
+    report("fs lookup (random)", lookups, ktime_ns() - t0, 0);
+
+    t0 = ktime_ns();
+    for (uint32_t i = 0; i < done; ++i) {
+        file_name(path, i);
+        fs_delete(fs, root, path);
+    }
+    report("fs delete", done, ktime_ns() - t0, 0);
+}
+
+static void bench_fs_io(fs_t *fs, uint32_t root) {
+    static const uint32_t sizes[] = {512u, 4096u, BENCH_IO_BYTES};
+    uint8_t *buf = (uint8_t *)kalloc(BENCH_IO_BYTES);
+    if (!buf) {
+        serial_write("  io: out of memory\r\n");
+        return;
+    }
+    for (uint32_t i = 0; i < BENCH_IO_BYTES; ++i) buf[i] = (uint8_t)i;
+    if (fs_create_file(fs, root, BENCH_FILE) != 0) {
+        serial_write("  io: cannot create test file\r\n");
+        kfree(buf);
+        return;
+    }
+    if (fs_write_file(fs, root, BENCH_FILE, buf, BENCH_IO_BYTES, 0) != 0) {
+        serial_write("  io: cannot fill test file\r\n");
+        fs_delete(fs, root, BENCH_FILE);
+        kfree(buf);
+        return;
+    }
+
+    char name[32];
+    for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        uint32_t size = sizes[s];
+        uint32_t per_pass = BENCH_IO_BYTES / size;
+        uint32_t ops = per_pass * BENCH_IO_PASSES;
+        size_t got;
+
+        for (int mode = 0; mode < 4; ++mode) {
+            int write = mode & 1;
+            int random = mode >> 1;
+            if (random && per_pass == 1) continue;
+            rng_seed(0x5eed0002u + size);
+            uint64_t t0 = ktime_ns();
+            for (uint32_t i = 0; i < ops; ++i) {
+                uint32_t off = (random ? rng_next() % per_pass : i % per_pass) * size;
+                if (write) fs_write_file(fs, root, BENCH_FILE, buf, size, off);
+                else fs_read_file(fs, root, BENCH_FILE, buf, size, off, &got);
+            }
+            uint64_t ns = ktime_ns() - t0;
+
+            strcpy(name, random ? "fs rand " : "fs seq ");
+            strcpy(name + strlen(name), write ? "write " : "read ");
+            strcpy(name + strlen(name), size == 512u ? "512B" : size == 4096u ? "4K" : "32K");
+            report(name, ops, ns, (uint64_t)ops * size);
+        }
+    }
+    fs_delete(fs, root, BENCH_FILE);
+    kfree(buf);
+}
+
+static void bench_heap(void) {
+    void *live[BENCH_HEAP_DEPTH];
+
+    rng_seed(0x5eed0003u);
+    uint64_t t0 = ktime_ns();
+    for (uint32_t i = 0; i < BENCH_HEAP_OPS; ++i) {
+        void *p = kalloc(16u + (rng_next() % 4080u));
+        kfree(p);
+    }
+    report("kalloc+kfree", BENCH_HEAP_OPS, ktime_ns() - t0, 0);
+
+    /* Random-order frees out of a window of live blocks fragment the heap. */
+    for (uint32_t i = 0; i < BENCH_HEAP_DEPTH; ++i) live[i] = kalloc(16u + (rng_next() % 4080u));
+    t0 = ktime_ns();
+    for (uint32_t i = 0; i < BENCH_HEAP_OPS; ++i) {
+        uint32_t slot = rng_next() % BENCH_HEAP_DEPTH;
+        kfree(live[slot]);
+        live[slot] = kalloc(16u + (rng_next() % 4080u));
+    }
+    report("kalloc churn (64 live)", BENCH_HEAP_OPS, ktime_ns() - t0, 0);
+    for (uint32_t i = 0; i < BENCH_HEAP_DEPTH; ++i) kfree(live[i]);
+}
+
+static void bench_memcpy(void) {
+    static const uint32_t sizes[] = {64u, 4096u, PAGE_SIZE << BENCH_COPY_ORDER};
+    uint8_t *src = (uint8_t *)pmm_alloc_pages(BENCH_COPY_ORDER);
+    uint8_t *dst = (uint8_t *)pmm_alloc_pages(BENCH_COPY_ORDER);
+    if (!src || !dst) {
+        serial_write("  memcpy: out of memory\r\n");
+        if (src) pmm_free_pages(src, BENCH_COPY_ORDER);
+        if (dst) pmm_free_pages(dst, BENCH_COPY_ORDER);
+        return;
+    }
+    memset(src, 0x5a, PAGE_SIZE << BENCH_COPY_ORDER);
+    memset(dst, 0, PAGE_SIZE << BENCH_COPY_ORDER);
+
+    char name[32];
+    for (uint32_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        uint32_t size = sizes[s];
+        uint32_t span = (PAGE_SIZE << BENCH_COPY_ORDER) / size;
+        uint64_t ops = BENCH_COPY_BYTES / size;
+        uint64_t t0 = ktime_ns();
+        for (uint64_t i = 0; i < ops; ++i) {
+            size_t off = (size_t)(i % span) * size;
+            memcpy(dst + off, src + off, size);
+        }
+        uint64_t ns = ktime_ns() - t0;
+        strcpy(name, size == 64u ? "memcpy 64B" : size == 4096u ? "memcpy 4K" : "memcpy 1M");
+        report(name, ops, ns, BENCH_COPY_BYTES);
+    }
+    pmm_free_pages(src, BENCH_COPY_ORDER);
+    pmm_free_pages(dst, BENCH_COPY_ORDER);
+}
+
+void bench_run(struct storage_state *storage, int argc, char **argv) {
+    const char *which = argc > 1 ? argv[1] : "all";
+    uint32_t files = parse_u32(argc > 2 ? argv[2] : NULL, BENCH_DEFAULT_FILES);
+    if (files == 0) files = 1;
+    if (files > BENCH_MAX_FILES) files = BENCH_MAX_FILES;
+    int all = strcmp(which, "all") == 0;
+    int run_fs = all || strcmp(which, "fs") == 0;
+    int run_io = all || strcmp(which, "io") == 0;
+    int run_heap = all || strcmp(which, "heap") == 0;
+    int run_mem = all || strcmp(which, "memcpy") == 0;
+    if (!run_fs && !run_io && !run_heap && !run_mem) {
+        serial_write("usage: bench [all|fs|io|heap|memcpy] [files]\r\n");
+        return;
+    }
+
+    serial_write("bench: clock ");
+    serial_write(time_source_name());
+    serial_write(", string ops ");
+    serial_write(string_ops_name());
+    serial_write("\r\n");
+
+    if (run_fs || run_io) {
+        fs_t *fs = &storage->fs;
+        if (!storage->fs_ready) {
+            serial_write("  fs: nothing mounted, skipping\r\n");
+        } else {
+            uint32_t root = fs_root_inode(fs);
+            serial_write("  backend: ");
+            serial_write(storage->using_ram ? "ram" : "virtio");
+            serial_write("\r\n");
+            struct fs_inode node;
+            uint32_t ino;
+            /* fs_make_dir() would add a second entry under the same name */
+            if (fs_lookup(fs, root, BENCH_DIR, &node, &ino) == 0) {
+                serial_write("  fs: " BENCH_DIR " left over from an earlier run; delete it first\r\n");
+            } else if (fs_make_dir(fs, root, BENCH_DIR) != 0) {
+                serial_write("  fs: cannot create " BENCH_DIR "\r\n");
+            } else {
+                if (run_fs) bench_fs_meta(fs, root, files);
+                if (run_io) bench_fs_io(fs, root);
+                if (fs_delete(fs, root, BENCH_DIR) != 0) {
+                    serial_write("  fs: cannot remove " BENCH_DIR "; delete it before the next run\r\n");
+                }
+            }
+        }
+    }
+    if (run_heap) bench_heap();
+    if (run_mem) bench_memcpy();
+}
@@ -0,0 +1,13 @@
+#ifndef AIOS_KERNEL_BENCH_H
+#define AIOS_KERNEL_BENCH_H
+
+#include "shell.h"
+
+/*
+ * In-guest microbenchmarks for the shell's `bench` command. Workloads use
+ * fixed sizes, counts and PRNG seeds so numbers are comparable between
+ * builds; fs runs go against whichever backend is mounted.
+ */
+void bench_run(struct storage_state *storage, int argc, char **argv);
+
+#endif
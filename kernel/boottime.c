@@ -0,0 +1,75 @@
+#include "boottime.h"
+#include "cpu.h"
+#include "serial.h"
+#include "time.h"
+
+#define BOOTTIME_MAX_PHASES 24
+
+struct boot_phase {
+    const char *name;
+    uint64_t tsc;
+};
+
+static const char *const loader_names[AIOS_LOADER_PHASES] = {
+    [AIOS_PHASE_LOADER_ENTRY] = "loader entry",
+    [AIOS_PHASE_OPEN_ROOT] = "loader: open ESP",
+    [AIOS_PHASE_KERNEL_READ] = "loader: read KERNEL.ELF",
+    [AIOS_PHASE_ELF_LOAD] = "loader: ELF load",
+    [AIOS_PHASE_FS_IMAGE] = "loader: read FS.IMG",
+    [AIOS_PHASE_MEMORY_MAP] = "loader: memory map",
+    [AIOS_PHASE_EXIT_BOOT_SERVICES] = "loader: ExitBootServices",
+};
+
+static struct boot_phase phases[BOOTTIME_MAX_PHASES];
+static uint32_t phase_count = 0;
+
+static void add_phase(const char *name, uint64_t tsc) {
+    if (phase_count >= BOOTTIME_MAX_PHASES) return;
+    phases[phase_count].name = name;
+    phases[phase_count].tsc = tsc;
+    phase_count++;
+}
+
+void boottime_init(const struct aios_boot_info *boot, uint64_t entry_tsc) {
+    phase_count = 0;
+    if (boot) {
+        for (int i = 0; i < AIOS_LOADER_PHASES; ++i) {
+            uint64_t tsc = boot->timeline.tsc[i];
+            if (tsc && tsc <= entry_tsc) add_phase(loader_names[i], tsc);
+        }
+    }
+    add_phase("kernel entry", entry_tsc);
+}
+
+void boottime_mark(const char *phase) {
+    add_phase(phase, rdtsc());
+}
+
+/* Prints "<ms>.<3 digits>" */
+static void write_ms(uint64_t ns) {
+    serial_write_u64(ns / NSEC_PER_MSEC);
+    serial_write(".");
+    uint32_t frac = (uint32_t)((ns % NSEC_PER_MSEC) / NSEC_PER_USEC);
+    if (frac < 100) serial_write("0");
+    if (frac < 10) serial_write("0");
+    serial_write_u32(frac);
+}
+
+void boottime_print(void) {
+    if (phase_count == 0) return;
+    uint64_t first = phases[0].tsc;
+    serial_write("[kernel] Boot timeline (ms, phase ends at / took):\r\n");
+    serial_write("  TSC reset to first stamp: ");
+    write_ms(tsc_to_ns(first));
+    serial_write("\r\n");
+    for (uint32_t i = 0; i < phase_count; ++i) {
+        uint64_t prev = i ? phases[i - 1].tsc : first;
+        serial_write("  ");
+        write_ms(tsc_to_ns(phases[i].tsc - first));
+        serial_write("  +");
+        write_ms(tsc_to_ns(phases[i].tsc - prev));
+        serial_write("  ");
+        serial_write(phases[i].name);
+        serial_write("\r\n");
+    }
+}
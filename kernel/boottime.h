@@ -0,0 +1,20 @@
+#ifndef AIOS_KERNEL_BOOTTIME_H
+#define AIOS_KERNEL_BOOTTIME_H
+
+#include <stdint.h>
+#include "aios/bootinfo.h"
+
+/*
+ * Boot phase timeline. The loader's TSC stamps (aios_boot_info.timeline)
+ * are merged with phases the kernel marks itself; each entry records when
+ * a phase finished, so its duration is the gap to the previous entry.
+ * Timestamps are raw TSC and converted with the calibrated rate when
+ * printed.
+ */
+
+/* boot may be NULL when the boot info failed validation. */
+void boottime_init(const struct aios_boot_info *boot, uint64_t entry_tsc);
+void boottime_mark(const char *phase);
+void boottime_print(void);
+
+#endif
@@ -0,0 +1,88 @@
+#include "cpu.h"
+
+static struct cpu_features features;
+
+static void enable_simd(void) {
+    uint64_t cr0 = read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    write_cr0(cr0);
+
+    uint64_t cr4 = read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT;
+    if (features.xsave) cr4 |= CR4_OSXSAVE;
+    write_cr4(cr4);
+    features.simd_state_size = FXSAVE_AREA_SIZE;
+    if (!features.xsave) return;
+    features.osxsave = true;
+
+    uint32_t a, b, c, d;
+    cpuid(0xD, 0, &a, &b, &c, &d);
+    uint64_t supported = ((uint64_t)d << 32) | a;
+    uint64_t xcr0 = XCR0_X87 | XCR0_SSE;
+    if (features.avx && (supported & XCR0_AVX)) xcr0 |= XCR0_AVX;
+    xsetbv(0, xcr0);
+    features.xcr0 = xgetbv(0);
+    features.avx_enabled = (features.xcr0 & XCR0_AVX) != 0;
+
+    cpuid(0xD, 0, &a, &b, &c, &d); /* EBX now reflects the enabled features */
+    if (b > features.simd_state_size) features.simd_state_size = b;
+}
+
+void cpu_init(void) {
+    uint32_t a, b, c, d;
+    cpuid(0, 0, &a, &b, &c, &d);
+    features.max_leaf = a;
+    const uint32_t vendor[3] = {b, d, c};
+    const char *v = (const char *)vendor;
+    for (int i = 0; i < 12; ++i) features.vendor[i] = v[i];
+    features.vendor[12] = '\0';
+
+    if (features.max_leaf >= 1) {
+        cpuid(1, 0, &a, &b, &c, &d);
+        features.sse2 = (d >> 26) & 1u;
+        features.pat = (d >> 16) & 1u;
+        features.tsc = (d >> 4) & 1u;
+        features.apic = (d >> 9) & 1u;
+        features.sse42 = (c >> 20) & 1u;
+        features.xsave = (c >> 26) & 1u;
+        features.osxsave = (c >> 27) & 1u;
+        features.avx = (c >> 28) & 1u;
+    }
+    if (features.max_leaf >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        features.avx2 = (b >> 5) & 1u;
+        features.erms = (b >> 9) & 1u;
+        features.fsrm = (d >> 4) & 1u;
+    }
+    cpuid(0x80000000u, 0, &a, &b, &c, &d);
+    features.max_ext_leaf = a;
+    if (features.max_ext_leaf >= 0x80000001u) {
+        cpuid(0x80000001u, 0, &a, &b, &c, &d);
+        features.pdpe1gb = (d >> 26) & 1u;
+    }
+    if (features.max_ext_leaf >= 0x80000007u) {
+        cpuid(0x80000007u, 0, &a, &b, &c, &d);
+        features.invariant_tsc = (d >> 8) & 1u;
+    }
+    enable_simd();
+}
+
+const struct cpu_features *cpu_get_features(void) {
+    return &features;
+}
+
+void cpu_simd_save(void *area) {
+    if (features.osxsave) {
+        __asm__ __volatile__("xsave64 (%0)" : : "r"(area), "a"((uint32_t)features.xcr0), "d"((uint32_t)(features.xcr0 >> 32)) : "memory");
+    } else {
+        __asm__ __volatile__("fxsave64 (%0)" : : "r"(area) : "memory");
+    }
+}
+
+void cpu_simd_restore(const void *area) {
+    if (features.osxsave) {
+        __asm__ __volatile__("xrstor64 (%0)" : : "r"(area), "a"((uint32_t)features.xcr0), "d"((uint32_t)(features.xcr0 >> 32)) : "memory");
+    } else {
+        __asm__ __volatile__("fxrstor64 (%0)" : : "r"(area) : "memory");
+    }
+}
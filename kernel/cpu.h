@@ -0,0 +1,153 @@
+#ifndef AIOS_KERNEL_CPU_H
+#define AIOS_KERNEL_CPU_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MSR_IA32_APIC_BASE 0x1B
+#define MSR_IA32_PAT 0x277
+
+#define CR0_MP (1ull << 1)
+#define CR0_EM (1ull << 2)
+#define CR0_TS (1ull << 3)
+#define CR0_NE (1ull << 5)
+
+#define CR4_PGE        (1ull << 7)
+#define CR4_OSFXSR     (1ull << 9)
+#define CR4_OSXMMEXCPT (1ull << 10)
+#define CR4_OSXSAVE    (1ull << 18)
+
+#define XCR0_X87 (1ull << 0)
+#define XCR0_SSE (1ull << 1)
+#define XCR0_AVX (1ull << 2)
+
+#define FXSAVE_AREA_SIZE 512u
+
+struct cpu_features {
+    char vendor[13];
+    uint32_t max_leaf;
+    uint32_t max_ext_leaf;
+    bool sse2;
+    bool sse42;
+    bool xsave;
+    bool osxsave;
+    bool avx;
+    bool avx2;
+    bool erms;     /* enhanced rep movsb/stosb */
+    bool fsrm;     /* fast short rep movsb */
+    bool pat;
+    bool pdpe1gb;
+    bool tsc;
+    bool apic;
+    bool invariant_tsc; /* constant rate across P/C-states */
+    bool avx_enabled;   /* AVX state switched on in XCR0; ymm registers usable */
+    uint64_t xcr0;
+    uint32_t simd_state_size; /* bytes needed by cpu_simd_save() */
+};
+
+/*
+ * Run CPUID once and switch on SSE (CR0/CR4) and, where present, XSAVE with
+ * AVX state in XCR0. Everything else reads the cached result.
+ */
+void cpu_init(void);
+const struct cpu_features *cpu_get_features(void);
+
+/*
+ * Vector register state for a context that uses SIMD: the area must be
+ * simd_state_size bytes, 64-byte aligned, and either zero-filled or written
+ * by a previous save. Uses xsave/xrstor when enabled, fxsave/fxrstor
+ * otherwise.
+ */
+void cpu_simd_save(void *area);
+void cpu_simd_restore(const void *area);
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    __asm__ __volatile__("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(subleaf));
+}
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    __asm__ __volatile__("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline uint64_t read_cr0(void) {
+    uint64_t v;
+    __asm__ __volatile__("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint64_t v) {
+    __asm__ __volatile__("mov %0, %%cr0" : : "r"(v) : "memory");
+}
+
+static inline uint64_t xgetbv(uint32_t index) {
+    uint32_t lo, hi;
+    __asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(index));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void xsetbv(uint32_t index, uint64_t value) {
+    __asm__ __volatile__("xsetbv" : : "c"(index), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline uint64_t read_cr3(void) {
+    uint64_t v;
+    __asm__ __volatile__("mov %%cr3, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr3(uint64_t v) {
+    __asm__ __volatile__("mov %0, %%cr3" : : "r"(v) : "memory");
+}
+
+static inline uint64_t read_cr4(void) {
+    uint64_t v;
+    __asm__ __volatile__("mov %%cr4, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr4(uint64_t v) {
+    __asm__ __volatile__("mov %0, %%cr4" : : "r"(v) : "memory");
+}
+
+static inline void irq_enable(void) {
+    __asm__ __volatile__("sti" : : : "memory");
+}
+
+static inline void irq_disable(void) {
+    __asm__ __volatile__("cli" : : : "memory");
+}
+
+static inline bool irq_enabled(void) {
+    uint64_t flags;
+    __asm__ __volatile__("pushfq; popq %0" : "=r"(flags));
+    return (flags & (1ull << 9)) != 0;
+}
+
+/* Disable interrupts, returning the previous RFLAGS for irq_restore(). */
+static inline uint64_t irq_save(void) {
+    uint64_t flags;
+    __asm__ __volatile__("pushfq; popq %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint64_t flags) {
+    if (flags & (1ull << 9)) irq_enable();
+}
+
+static inline void wbinvd(void) {
+    __asm__ __volatile__("wbinvd" : : : "memory");
+}
+
+#endif
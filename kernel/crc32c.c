@@ -0,0 +1,33 @@
+#include "crc32c.h"
+#include "cpu.h"
+#include "aios/crc32c.h"
+
+/* SSE4.2 crc32: one 8-byte step per instruction. */
+static uint32_t crc32c_hw(uint32_t crc, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t c = (uint32_t)~crc;
+    while (len && ((uintptr_t)p & 7u)) {
+        __asm__("crc32b %1, %k0" : "+r"(c) : "rm"(*p));
+        p++;
+        len--;
+    }
+    while (len >= 8) {
+        __asm__("crc32q %1, %0" : "+r"(c) : "rm"(*(const uint64_t *)p));
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        __asm__("crc32b %1, %k0" : "+r"(c) : "rm"(*p));
+        p++;
+    }
+    return ~(uint32_t)c;
+}
+
+uint32_t crc32c(uint32_t crc, const void *data, size_t len) {
+    if (cpu_get_features()->sse42) return crc32c_hw(crc, data, len);
+    return aios_crc32c_sw(crc, data, len);
+}
+
+const char *crc32c_impl_name(void) {
+    return cpu_get_features()->sse42 ? "sse4.2" : "slicing-by-8";
+}
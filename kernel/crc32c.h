@@ -0,0 +1,11 @@
+#ifndef AIOS_KERNEL_CRC32C_H
+#define AIOS_KERNEL_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC32C of data, continuing from crc (0 to start). Needs cpu_init(). */
+uint32_t crc32c(uint32_t crc, const void *data, size_t len);
+const char *crc32c_impl_name(void);
+
+#endif
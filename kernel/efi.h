@@ -0,0 +1,49 @@
+#ifndef AIOS_KERNEL_EFI_H
+#define AIOS_KERNEL_EFI_H
+
+#include <stdint.h>
+#include "aios/bootinfo.h"
+
+/* UEFI memory map as handed over by the loader. */
+
+#define EFI_RESERVED_MEMORY      0
+#define EFI_LOADER_CODE          1
+#define EFI_LOADER_DATA          2
+#define EFI_BOOT_SERVICES_CODE   3
+#define EFI_BOOT_SERVICES_DATA   4
+#define EFI_RUNTIME_CODE         5
+#define EFI_RUNTIME_DATA         6
+#define EFI_CONVENTIONAL_MEMORY  7
+#define EFI_UNUSABLE_MEMORY      8
+#define EFI_ACPI_RECLAIM         9
+#define EFI_ACPI_NVS             10
+#define EFI_MMIO                 11
+#define EFI_MMIO_PORT_SPACE      12
+#define EFI_PAL_CODE             13
+#define EFI_PERSISTENT_MEMORY    14
+
+#define EFI_PAGE_SIZE 4096ull
+
+struct efi_memory_descriptor {
+    uint32_t type;
+    uint32_t pad;
+    uint64_t physical_start;
+    uint64_t virtual_start;
+    uint64_t number_of_pages;
+    uint64_t attribute;
+};
+
+static inline uint64_t efi_descriptor_count(const struct aios_boot_info *boot) {
+    if (!boot->memory_map.buffer || boot->memory_map.descriptor_size < sizeof(struct efi_memory_descriptor)) return 0;
+    return boot->memory_map.size / boot->memory_map.descriptor_size;
+}
+
+static inline const struct efi_memory_descriptor *efi_descriptor(const struct aios_boot_info *boot, uint64_t i) {
+    return (const struct efi_memory_descriptor *)(uintptr_t)(boot->memory_map.buffer + i * boot->memory_map.descriptor_size);
+}
+
+static inline uint64_t efi_descriptor_end(const struct efi_memory_descriptor *d) {
+    return d->physical_start + d->number_of_pages * EFI_PAGE_SIZE;
+}
+
+#endif
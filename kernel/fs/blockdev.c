@@ -1,6 +1,8 @@
 #include "blockdev.h"
 #include "util.h"
 #include "mem.h"
+#include "time.h"
+#include "trace.h"
 
 struct ram_ctx {
     uint8_t *base;
@@ -20,27 +22,80 @@ static int ram_write(struct blockdev *bd, uint32_t block, const void *buf) {
     return 0;
 }
 
+static int ram_zero(struct blockdev *bd, uint32_t block, uint32_t count) {
+    struct ram_ctx *rc = (struct ram_ctx *)bd->ctx;
+    memzero_nt(rc->base + ((size_t)block * bd->block_size), (size_t)count * bd->block_size);
+    return 0;
+}
+
 int bd_init_ram(struct blockdev *bd, void *base, uint32_t bytes, uint32_t block_size) {
     if (block_size == 0 || bytes < block_size) return -1;
     struct ram_ctx *ctx = (struct ram_ctx *)kalloc(sizeof(struct ram_ctx));
-    if (!ctx) return -1;
+    struct bd_stats *stats = (struct bd_stats *)kcalloc(1, sizeof(struct bd_stats));
+    if (!ctx || !stats) {
+        kfree(ctx);
+        kfree(stats);
+        return -1;
+    }
     ctx->base = (uint8_t *)base;
     bd->ctx = ctx;
+    bd->stats = stats;
     bd->block_size = block_size;
     bd->blocks = bytes / block_size;
     bd->read_fn = ram_read;
     bd->write_fn = ram_write;
+    bd->zero_fn = ram_zero;
     return 0;
 }
 
 int bd_read(struct blockdev *bd, uint32_t block, void *buf) {
     if (!bd->read_fn) return -1;
     if (block >= bd->blocks) return -1;
-    return bd->read_fn(bd, block, buf);
+    TRACE(TRACE_BD_READ_BEGIN, block, 0);
+    uint64_t start = ktime_ns();
+    int rc = bd->read_fn(bd, block, buf);
+    TRACE(TRACE_BD_READ_END, block, (uint32_t)rc);
+    if (bd->stats) {
+        hist_add(&bd->stats->read_lat, ktime_ns() - start);
+        bd->stats->reads++;
+        bd->stats->read_bytes += bd->block_size;
+        if (rc != 0) bd->stats->errors++;
+    }
+    return rc;
 }
 
 int bd_write(struct blockdev *bd, uint32_t block, const void *buf) {
     if (!bd->write_fn) return -1;
     if (block >= bd->blocks) return -1;
-    return bd->write_fn(bd, block, buf);
+    TRACE(TRACE_BD_WRITE_BEGIN, block, 0);
+    uint64_t start = ktime_ns();
+    int rc = bd->write_fn(bd, block, buf);
+    TRACE(TRACE_BD_WRITE_END, block, (uint32_t)rc);
+    if (bd->stats) {
+        hist_add(&bd->stats->write_lat, ktime_ns() - start);
+        bd->stats->writes++;
+        bd->stats->write_bytes += bd->block_size;
+        if (rc != 0) bd->stats->errors++;
+    }
+    return rc;
+}
+
+int bd_zero(struct blockdev *bd, uint32_t block, uint32_t count) {
+    if (block > bd->blocks || count > bd->blocks - block) return -1;
+    if (count == 0) return 0;
+    if (bd->stats) bd->stats->zeroed_blocks += count;
+    if (bd->zero_fn) return bd->zero_fn(bd, block, count);
+    if (!bd->write_fn) return -1;
+    uint8_t *zero = (uint8_t *)kcalloc(1, bd->block_size);
+    if (!zero) return -1;
+    int rc = 0;
+    for (uint32_t i = 0; i < count && rc == 0; ++i) {
+        rc = bd->write_fn(bd, block + i, zero);
+    }
+    kfree(zero);
+    return rc;
+}
+
+void bd_stats_reset(struct blockdev *bd) {
+    if (bd->stats) memset(bd->stats, 0, sizeof(*bd->stats));
 }
@@ -3,21 +3,39 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "hist.h"
 
 struct blockdev;
 typedef int (*block_read_fn)(struct blockdev *bd, uint32_t block, void *buf);
 typedef int (*block_write_fn)(struct blockdev *bd, uint32_t block, const void *buf);
+typedef int (*block_zero_fn)(struct blockdev *bd, uint32_t block, uint32_t count);
+
+/* Shared by every copy of a blockdev (fs_t keeps its own copy). */
+struct bd_stats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t read_bytes;
+    uint64_t write_bytes;
+    uint64_t zeroed_blocks;
+    uint64_t errors;
+    struct hist read_lat;  /* bd_read() wall time */
+    struct hist write_lat;
+};
 
 struct blockdev {
     void *ctx;
+    struct bd_stats *stats;
     uint32_t blocks;
     uint32_t block_size;
     block_read_fn read_fn;
     block_write_fn write_fn;
+    block_zero_fn zero_fn; /* optional; bd_zero() falls back to writes */
 };
 
 int bd_init_ram(struct blockdev *bd, void *base, uint32_t bytes, uint32_t block_size);
 int bd_read(struct blockdev *bd, uint32_t block, void *buf);
 int bd_write(struct blockdev *bd, uint32_t block, const void *buf);
+int bd_zero(struct blockdev *bd, uint32_t block, uint32_t count);
+void bd_stats_reset(struct blockdev *bd);
 
 #endif /* AIOS_BLOCKDEV_H */
@@ -1,18 +1,87 @@
 #include "fs.h"
+#include "arena.h"
 #include "blockdev.h"
+#include "crc32c.h"
 #include "mem.h"
+#include "slab.h"
+#include "trace.h"
 #include "util.h"
 
 static uint32_t div_ceil(uint32_t x, uint32_t y) { return (x + y - 1u) / y; }
 
+/*
+ * Block-sized scratch buffers come from a per-block-size slab cache and are
+ * handed out by the per-fs arena; each public call releases them on return.
+ */
+#define FS_BLOCK_CACHES 2
+static struct slab_cache *block_caches[FS_BLOCK_CACHES];
+
+static struct slab_cache *block_cache_for(uint32_t bs) {
+    for (int i = 0; i < FS_BLOCK_CACHES; ++i) {
+        if (block_caches[i] && block_caches[i]->obj_size == bs) return block_caches[i];
+    }
+    for (int i = 0; i < FS_BLOCK_CACHES; ++i) {
+        if (!block_caches[i]) {
+            size_t align = (bs & (bs - 1u)) == 0 ? bs : 0; /* page-aligned blocks when possible */
+            block_caches[i] = slab_cache_create("fs-block", bs, align, NULL);
+            return block_caches[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t *scratch_block(struct fs *fs) {
+    return (uint8_t *)arena_alloc(&fs->scratch, fs->sb.block_size);
+}
+
+static uint8_t *scratch_block_zeroed(struct fs *fs) {
+    uint8_t *buf = scratch_block(fs);
+    if (buf) memset(buf, 0, fs->sb.block_size);
+    return buf;
+}
+
 static int bitmap_test(uint8_t *bm, uint32_t idx) { return (bm[idx / 8u] >> (idx % 8u)) & 1u; }
 static void bitmap_set(uint8_t *bm, uint32_t idx) { bm[idx / 8u] |= (uint8_t)(1u << (idx % 8u)); }
 static void bitmap_clear(uint8_t *bm, uint32_t idx) { bm[idx / 8u] &= (uint8_t)~(1u << (idx % 8u)); }
 
+static int is_meta_block(struct fs *fs, uint32_t blk) {
+    return fs->meta_crc && blk >= 1 && blk <= fs->meta_blocks;
+}
+
+/* Metadata block I/O: reads are verified and writes update the checksum table. */
+static int meta_read(struct fs *fs, uint32_t blk, uint8_t *buf) {
+    if (bd_read(&fs->bd, blk, buf) != 0) return -1;
+    if (is_meta_block(fs, blk) && crc32c(0, buf, fs->sb.block_size) != fs->meta_crc[blk - 1]) {
+        fs->stats.csum_errors++;
+        return -1;
+    }
+    return 0;
+}
+
+static int meta_write(struct fs *fs, uint32_t blk, const uint8_t *buf) {
+    if (bd_write(&fs->bd, blk, buf) != 0) return -1;
+    if (is_meta_block(fs, blk)) {
+        fs->meta_crc[blk - 1] = crc32c(0, buf, fs->sb.block_size);
+        fs->meta_dirty = true;
+    }
+    return 0;
+}
+
+static uint32_t csum_capacity(uint32_t bs) {
+    return (bs - FS_CSUM_OFFSET - (uint32_t)sizeof(struct fs_csum_header)) / (uint32_t)sizeof(uint32_t);
+}
+
+static uint32_t block0_crc(struct fs *fs) {
+    uint32_t crc = crc32c(0, &fs->sb, sizeof(fs->sb));
+    return crc32c(crc, fs->meta_crc, fs->meta_blocks * sizeof(uint32_t));
+}
+
 static int sync_bitmap(struct fs *fs, uint8_t *bm, uint32_t start_block, uint32_t block_count) {
     uint32_t bs = fs->sb.block_size;
+    TRACE(TRACE_FS_BITMAP_SYNC, start_block, block_count);
+    fs->stats.bitmap_syncs++;
     for (uint32_t i = 0; i < block_count; ++i) {
-        if (bd_write(&fs->bd, start_block + i, bm + i * bs) != 0) return -1;
+        if (meta_write(fs, start_block + i, bm + i * bs) != 0) return -1;
     }
     return 0;
 }
@@ -22,18 +91,33 @@ static int load_bitmap(struct fs *fs, uint8_t **out, uint32_t start_block, uint3
     uint8_t *buf = kcalloc(block_count, bs);
     if (!buf) return -1;
     for (uint32_t i = 0; i < block_count; ++i) {
-        if (bd_read(&fs->bd, start_block + i, buf + i * bs) != 0) return -1;
+        if (meta_read(fs, start_block + i, buf + i * bs) != 0) {
+            kfree(buf);
+            return -1;
+        }
     }
     *out = buf;
     return 0;
 }
 
 static int write_superblock(struct fs *fs) {
-    uint32_t bs = fs->sb.block_size;
-    uint8_t *buf = kcalloc(1, bs);
-    if (!buf) return -1;
-    memcpy(buf, &fs->sb, sizeof(fs->sb));
-    int rc = bd_write(&fs->bd, 0, buf);
+    fs->stats.superblock_writes++;
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    uint8_t *buf = scratch_block_zeroed(fs);
+    int rc = -1;
+    if (buf) {
+        memcpy(buf, &fs->sb, sizeof(fs->sb));
+        if (fs->meta_crc) {
+            struct fs_csum_header *hdr = (struct fs_csum_header *)(buf + FS_CSUM_OFFSET);
+            hdr->magic = FS_CSUM_MAGIC;
+            hdr->blocks = fs->meta_blocks;
+            hdr->crc = block0_crc(fs);
+            memcpy(hdr + 1, fs->meta_crc, fs->meta_blocks * sizeof(uint32_t));
+        }
+        rc = bd_write(&fs->bd, 0, buf);
+        if (rc == 0) fs->meta_dirty = false;
+    }
+    arena_release(&fs->scratch, mark);
     return rc;
 }
 
@@ -66,13 +150,31 @@ static int layout_compute(struct fs_superblock *sb, uint32_t total_blocks, uint3
 
 static int read_superblock(struct fs *fs) {
     uint32_t bs = fs->bd.block_size;
-    uint8_t *buf = kcalloc(1, bs);
-    if (!buf) return -1;
-    if (bd_read(&fs->bd, 0, buf) != 0) return -1;
-    memcpy(&fs->sb, buf, sizeof(fs->sb));
-    if (fs->sb.magic != FS_MAGIC) return -1;
-    if (fs->sb.block_size != bs) return -1;
-    return 0;
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    uint8_t *buf = (uint8_t *)arena_alloc(&fs->scratch, bs); /* sb not loaded yet */
+    int rc = buf ? bd_read(&fs->bd, 0, buf) : -1;
+    if (rc == 0) {
+        memcpy(&fs->sb, buf, sizeof(fs->sb));
+        if (fs->sb.magic != FS_MAGIC || fs->sb.block_size != bs) rc = -1;
+    }
+    const struct fs_csum_header *hdr = (const struct fs_csum_header *)(buf + FS_CSUM_OFFSET);
+    if (rc == 0 && hdr->magic == FS_CSUM_MAGIC) {
+        if (hdr->blocks != fs->sb.data_region_start - 1 || hdr->blocks > csum_capacity(bs)) {
+            rc = -1;
+        } else {
+            fs->meta_crc = (uint32_t *)kalloc(hdr->blocks * sizeof(uint32_t));
+            if (!fs->meta_crc) {
+                rc = -1;
+            } else {
+                fs->meta_blocks = hdr->blocks;
+                memcpy(fs->meta_crc, hdr + 1, hdr->blocks * sizeof(uint32_t));
+                if (block0_crc(fs) != hdr->crc) rc = -1;
+            }
+        }
+        if (rc != 0) fs->stats.csum_errors++;
+    }
+    arena_release(&fs->scratch, mark);
+    return rc;
 }
 
 static int read_inode(struct fs *fs, uint32_t ino, struct fs_inode *out) {
@@ -81,11 +183,13 @@ static int read_inode(struct fs *fs, uint32_t ino, struct fs_inode *out) {
     uint32_t off = ino * sizeof(struct fs_inode);
     uint32_t blk = fs->sb.inode_table_start + off / bs;
     uint32_t within = off % bs;
-    uint8_t *buf = kcalloc(1, bs);
-    if (!buf) return -1;
-    if (bd_read(&fs->bd, blk, buf) != 0) return -1;
-    memcpy(out, buf + within, sizeof(*out));
-    return 0;
+    fs->stats.inode_reads++;
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    uint8_t *buf = scratch_block(fs);
+    int rc = buf ? meta_read(fs, blk, buf) : -1;
+    if (rc == 0) memcpy(out, buf + within, sizeof(*out));
+    arena_release(&fs->scratch, mark);
+    return rc;
 }
 
 static int write_inode(struct fs *fs, uint32_t ino, const struct fs_inode *in) {
@@ -94,11 +198,16 @@ static int write_inode(struct fs *fs, uint32_t ino, const struct fs_inode *in) {
     uint32_t off = ino * sizeof(struct fs_inode);
     uint32_t blk = fs->sb.inode_table_start + off / bs;
     uint32_t within = off % bs;
-    uint8_t *buf = kcalloc(1, bs);
-    if (!buf) return -1;
-    if (bd_read(&fs->bd, blk, buf) != 0) return -1;
-    memcpy(buf + within, in, sizeof(*in));
-    return bd_write(&fs->bd, blk, buf);
+    fs->stats.inode_writes++;
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    uint8_t *buf = scratch_block(fs);
+    int rc = buf ? meta_read(fs, blk, buf) : -1;
+    if (rc == 0) {
+        memcpy(buf + within, in, sizeof(*in));
+        rc = meta_write(fs, blk, buf);
+    }
+    arena_release(&fs->scratch, mark);
+    return rc;
 }
 
 static int alloc_from_bitmap(uint8_t *bm, uint32_t start, uint32_t limit, uint32_t *out) {
@@ -139,11 +248,11 @@ static int free_data_block_id(struct fs *fs, uint32_t abs_block) {
     return sync_bitmap(fs, fs->data_bitmap, fs->sb.data_bitmap_start, fs->sb.data_bitmap_blocks);
 }
 
+/* Returns the directory block in a scratch buffer owned by the current call. */
 static int dir_load(fs_t *fs, const struct fs_inode *dir, uint8_t **out) {
-    uint32_t bs = fs->sb.block_size;
-    uint8_t *buf = kcalloc(1, bs);
-    if (!buf) return -1;
     if (dir->direct[0] == 0) return -1;
+    uint8_t *buf = scratch_block(fs);
+    if (!buf) return -1;
     if (bd_read(&fs->bd, dir->direct[0], buf) != 0) return -1;
     *out = buf;
     return 0;
@@ -155,18 +264,23 @@ static int dir_save(fs_t *fs, struct fs_inode *dir, uint8_t *buf) {
 }
 
 static int dir_find_entry(fs_t *fs, struct fs_inode *dir, const char *name, struct fs_dirent_disk *out_ent, uint32_t *out_index) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
     uint8_t *buf = NULL;
-    if (dir_load(fs, dir, &buf) != 0) return -1;
-    uint32_t count = dir->size / sizeof(struct fs_dirent_disk);
-    struct fs_dirent_disk *ents = (struct fs_dirent_disk *)buf;
-    for (uint32_t i = 0; i < count; ++i) {
-        if (ents[i].inode != 0 && strcmp(ents[i].name, name) == 0) {
-            if (out_ent) memcpy(out_ent, &ents[i], sizeof(*out_ent));
-            if (out_index) *out_index = i;
-            return 0;
+    int rc = -1;
+    if (dir_load(fs, dir, &buf) == 0) {
+        uint32_t count = dir->size / sizeof(struct fs_dirent_disk);
+        struct fs_dirent_disk *ents = (struct fs_dirent_disk *)buf;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (ents[i].inode != 0 && strcmp(ents[i].name, name) == 0) {
+                if (out_ent) memcpy(out_ent, &ents[i], sizeof(*out_ent));
+                if (out_index) *out_index = i;
+                rc = 0;
+                break;
+            }
         }
     }
-    return -1;
+    arena_release(&fs->scratch, mark);
+    return rc;
 }
 
 static int dir_add_entry(fs_t *fs, struct fs_inode *dir, uint32_t dir_ino, const char *name, uint32_t ino, uint8_t type) {
@@ -207,7 +321,7 @@ static int path_split_component(const char **p, char *component) {
     return 1;
 }
 
-static int resolve_path(fs_t *fs, uint32_t start_ino, const char *path, struct fs_inode *out_inode, uint32_t *out_ino) {
+static int walk_path(fs_t *fs, uint32_t start_ino, const char *path, struct fs_inode *out_inode, uint32_t *out_ino) {
     uint32_t cur_ino = (*path == '/') ? fs->sb.root_inode : start_ino;
     struct fs_inode cur;
     if (read_inode(fs, cur_ino, &cur) != 0) return -1;
@@ -231,19 +345,50 @@ static int resolve_path(fs_t *fs, uint32_t start_ino, const char *path, struct f
     return 0;
 }
 
-/* Public API */
+static int resolve_path(fs_t *fs, uint32_t start_ino, const char *path, struct fs_inode *out_inode, uint32_t *out_ino) {
+    TRACE(TRACE_FS_RESOLVE_BEGIN, start_ino, 0);
+    uint32_t ino = 0;
+    int rc = walk_path(fs, start_ino, path, out_inode, &ino);
+    if (rc == 0 && out_ino) *out_ino = ino;
+    TRACE(TRACE_FS_RESOLVE_END, ino, (uint32_t)rc);
+    return rc;
+}
 
-int fs_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count) {
+/* Drop any previous mount state and bind fs to bd. */
+static int attach(fs_t *fs, struct blockdev *bd) {
+    kfree(fs->inode_bitmap);
+    kfree(fs->data_bitmap);
+    kfree(fs->meta_crc);
+    fs->inode_bitmap = NULL;
+    fs->data_bitmap = NULL;
+    fs->meta_crc = NULL;
+    fs->meta_blocks = 0;
+    fs->meta_dirty = false;
+    if (fs->scratch.source) arena_destroy(&fs->scratch);
     fs->bd = *bd;
+    fs->block_cache = block_cache_for(bd->block_size);
+    if (!fs->block_cache) return -1;
+    arena_init(&fs->scratch, fs->block_cache);
+    return 0;
+}
+
+static int do_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count) {
     uint32_t total_blocks = bd->blocks;
     uint32_t block_size = bd->block_size;
     if (layout_compute(&fs->sb, total_blocks, inode_count, block_size) != 0) return -1;
 
     /* Zero disk */
-    uint8_t *zero = kcalloc(1, block_size);
-    if (!zero) return -1;
-    for (uint32_t b = 0; b < total_blocks; ++b) {
-        bd_write(&fs->bd, b, zero);
+    if (bd_zero(&fs->bd, 0, total_blocks) != 0) return -1;
+
+    /* Checksum every metadata block when the table fits in block 0 */
+    uint32_t meta_blocks = fs->sb.data_region_start - 1;
+    if (meta_blocks <= csum_capacity(block_size)) {
+        uint8_t *zero = scratch_block_zeroed(fs);
+        fs->meta_crc = (uint32_t *)kalloc(meta_blocks * sizeof(uint32_t));
+        if (!zero || !fs->meta_crc) return -1;
+        uint32_t zero_crc = crc32c(0, zero, block_size);
+        for (uint32_t i = 0; i < meta_blocks; ++i) fs->meta_crc[i] = zero_crc;
+        fs->meta_blocks = meta_blocks;
     }
 
     /* Allocate bitmaps */
@@ -251,10 +396,7 @@ int fs_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count) {
     fs->data_bitmap  = kcalloc(fs->sb.data_bitmap_blocks, block_size);
     if (!fs->inode_bitmap || !fs->data_bitmap) return -1;
 
-    /* Mark metadata blocks as used in data bitmap */
-    for (uint32_t b = 0; b < fs->sb.data_region_start; ++b) {
-        bitmap_set(fs->data_bitmap, b - fs->sb.data_region_start);
-    }
+    /* The data bitmap only covers the data region, so metadata needs no bits. */
 
     /* Reserve root inode */
     bitmap_set(fs->inode_bitmap, fs->sb.root_inode);
@@ -271,7 +413,8 @@ int fs_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count) {
     if (alloc_data_block(fs, &root.direct[0]) != 0) return -1;
 
     /* Directory entries: . and .. */
-    uint8_t *buf = kcalloc(1, block_size);
+    uint8_t *buf = scratch_block_zeroed(fs);
+    if (!buf) return -1;
     struct fs_dirent_disk *ents = (struct fs_dirent_disk *)buf;
     ents[0].inode = fs->sb.root_inode;
     ents[0].type = FS_INODE_DIR;
@@ -285,21 +428,15 @@ int fs_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count) {
     return 0;
 }
 
-int fs_mount(fs_t *fs, struct blockdev *bd) {
-    fs->bd = *bd;
+static int do_mount(fs_t *fs) {
     if (read_superblock(fs) != 0) return -1;
     if (load_bitmap(fs, &fs->inode_bitmap, fs->sb.inode_bitmap_start, fs->sb.inode_bitmap_blocks) != 0) return -1;
     if (load_bitmap(fs, &fs->data_bitmap, fs->sb.data_bitmap_start, fs->sb.data_bitmap_blocks) != 0) return -1;
     return 0;
 }
 
-uint32_t fs_root_inode(const fs_t *fs) { return fs->sb.root_inode; }
 
-int fs_lookup(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_inode *out_inode, uint32_t *out_ino) {
-    return resolve_path(fs, cwd_inode, path, out_inode, out_ino);
-}
-
-int fs_make_dir(fs_t *fs, uint32_t cwd_inode, const char *path) {
+static int do_make_dir(fs_t *fs, uint32_t cwd_inode, const char *path) {
     /* Split parent path and leaf */
     const char *last_slash = path;
     const char *p = path;
@@ -333,7 +470,8 @@ int fs_make_dir(fs_t *fs, uint32_t cwd_inode, const char *path) {
     if (alloc_data_block(fs, &dir.direct[0]) != 0) return -1;
 
     /* init dirents */
-    uint8_t *buf = kcalloc(1, fs->sb.block_size);
+    uint8_t *buf = scratch_block_zeroed(fs);
+    if (!buf) return -1;
     struct fs_dirent_disk *ents = (struct fs_dirent_disk *)buf;
     ents[0].inode = new_ino; ents[0].type = FS_INODE_DIR; strcpy(ents[0].name, ".");
     ents[1].inode = parent_ino; ents[1].type = FS_INODE_DIR; strcpy(ents[1].name, "..");
@@ -344,7 +482,7 @@ int fs_make_dir(fs_t *fs, uint32_t cwd_inode, const char *path) {
     return dir_add_entry(fs, &parent, parent_ino, leaf, new_ino, FS_INODE_DIR);
 }
 
-int fs_create_file(fs_t *fs, uint32_t cwd_inode, const char *path) {
+static int do_create_file(fs_t *fs, uint32_t cwd_inode, const char *path) {
     const char *last_slash = path;
     const char *p = path;
     while (*p) { if (*p == '/') last_slash = p; p++; }
@@ -374,7 +512,7 @@ int fs_create_file(fs_t *fs, uint32_t cwd_inode, const char *path) {
     return dir_add_entry(fs, &parent, parent_ino, leaf, ino, FS_INODE_FILE);
 }
 
-int fs_delete(fs_t *fs, uint32_t cwd_inode, const char *path) {
+static int do_delete(fs_t *fs, uint32_t cwd_inode, const char *path) {
     struct fs_inode target, parent;
     uint32_t target_ino, parent_ino;
 
@@ -395,7 +533,9 @@ int fs_delete(fs_t *fs, uint32_t cwd_inode, const char *path) {
 
     if (resolve_path(fs, cwd_inode, parent_path, &parent, &parent_ino) != 0) return -1;
     if (parent.type != FS_INODE_DIR) return -1;
-    if (dir_find_entry(fs, &parent, leaf, NULL, &target_ino) != 0) return -1;
+    struct fs_dirent_disk ent;
+    if (dir_find_entry(fs, &parent, leaf, &ent, NULL) != 0) return -1;
+    target_ino = ent.inode;
     if (read_inode(fs, target_ino, &target) != 0) return -1;
 
     /* if dir, ensure empty (only . and ..) */
@@ -434,7 +574,7 @@ int fs_delete(fs_t *fs, uint32_t cwd_inode, const char *path) {
     return 0;
 }
 
-int fs_write_file(fs_t *fs, uint32_t cwd_inode, const char *path, const uint8_t *data, size_t len, uint32_t offset) {
+static int do_write_file(fs_t *fs, uint32_t cwd_inode, const char *path, const uint8_t *data, size_t len, uint32_t offset) {
     struct fs_inode file;
     uint32_t ino;
     if (resolve_path(fs, cwd_inode, path, &file, &ino) != 0) return -1;
@@ -443,7 +583,7 @@ int fs_write_file(fs_t *fs, uint32_t cwd_inode, const char *path, const uint8_t
     uint32_t max_bytes = FS_DIRECT_BLOCKS * bs;
     if (offset + len > max_bytes) return -1;
 
-    uint8_t *buf = kcalloc(1, bs);
+    uint8_t *buf = scratch_block(fs);
     if (!buf) return -1;
     size_t remaining = len;
     size_t written = 0;
@@ -466,14 +606,14 @@ int fs_write_file(fs_t *fs, uint32_t cwd_inode, const char *path, const uint8_t
     return write_inode(fs, ino, &file);
 }
 
-int fs_read_file(fs_t *fs, uint32_t cwd_inode, const char *path, uint8_t *out, size_t len, uint32_t offset, size_t *bytes_read) {
+static int do_read_file(fs_t *fs, uint32_t cwd_inode, const char *path, uint8_t *out, size_t len, uint32_t offset, size_t *bytes_read) {
     struct fs_inode file;
     uint32_t ino;
     if (resolve_path(fs, cwd_inode, path, &file, &ino) != 0) return -1;
     if (file.type != FS_INODE_FILE) return -1;
     if (offset >= file.size) { *bytes_read = 0; return 0; }
     uint32_t bs = fs->sb.block_size;
-    uint8_t *buf = kcalloc(1, bs);
+    uint8_t *buf = scratch_block(fs);
     if (!buf) return -1;
     size_t remaining = (offset + len > file.size) ? (file.size - offset) : len;
     size_t read = 0;
@@ -493,13 +633,86 @@ int fs_read_file(fs_t *fs, uint32_t cwd_inode, const char *path, uint8_t *out, s
     return 0;
 }
 
-int fs_list_dir(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_dirent_disk **out_entries, size_t *out_count) {
+static int do_list_dir(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_dirent_disk **out_entries, size_t *out_count) {
     struct fs_inode dir;
     if (resolve_path(fs, cwd_inode, path, &dir, NULL) != 0) return -1;
     if (dir.type != FS_INODE_DIR) return -1;
     uint8_t *buf = NULL;
     if (dir_load(fs, &dir, &buf) != 0) return -1;
-    *out_entries = (struct fs_dirent_disk *)buf;
-    *out_count = dir.size / sizeof(struct fs_dirent_disk);
+    size_t count = dir.size / sizeof(struct fs_dirent_disk);
+    struct fs_dirent_disk *ents = (struct fs_dirent_disk *)kalloc((count ? count : 1) * sizeof(*ents));
+    if (!ents) return -1;
+    memcpy(ents, buf, count * sizeof(*ents));
+    *out_entries = ents;
+    *out_count = count;
     return 0;
 }
+
+/*
+ * Public API: every call ends by writing back the checksum table if it
+ * changed and releasing its scratch buffers.
+ */
+
+static int end_call(fs_t *fs, arena_mark_t mark, int op, int rc) {
+    if (fs->meta_dirty) {
+        TRACE(TRACE_FS_META_FLUSH, 0, 0);
+        if (write_superblock(fs) != 0) rc = -1;
+    }
+    arena_release(&fs->scratch, mark);
+    TRACE(TRACE_FS_OP_END, op, (uint32_t)rc);
+    return rc;
+}
+
+int fs_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count) {
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_FORMAT, inode_count);
+    if (attach(fs, bd) != 0) return -1;
+    return end_call(fs, 0, TRACE_FS_FORMAT, do_format(fs, bd, inode_count));
+}
+
+int fs_mount(fs_t *fs, struct blockdev *bd) {
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_MOUNT, 0);
+    if (attach(fs, bd) != 0) return -1;
+    return end_call(fs, 0, TRACE_FS_MOUNT, do_mount(fs));
+}
+
+uint32_t fs_root_inode(const fs_t *fs) { return fs->sb.root_inode; }
+
+int fs_lookup(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_inode *out_inode, uint32_t *out_ino) {
+    return resolve_path(fs, cwd_inode, path, out_inode, out_ino);
+}
+
+int fs_make_dir(fs_t *fs, uint32_t cwd_inode, const char *path) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_MKDIR, 0);
+    return end_call(fs, mark, TRACE_FS_MKDIR, do_make_dir(fs, cwd_inode, path));
+}
+
+int fs_create_file(fs_t *fs, uint32_t cwd_inode, const char *path) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_CREATE, 0);
+    return end_call(fs, mark, TRACE_FS_CREATE, do_create_file(fs, cwd_inode, path));
+}
+
+int fs_delete(fs_t *fs, uint32_t cwd_inode, const char *path) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_DELETE, 0);
+    return end_call(fs, mark, TRACE_FS_DELETE, do_delete(fs, cwd_inode, path));
+}
+
+int fs_write_file(fs_t *fs, uint32_t cwd_inode, const char *path, const uint8_t *data, size_t len, uint32_t offset) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_WRITE, len);
+    return end_call(fs, mark, TRACE_FS_WRITE, do_write_file(fs, cwd_inode, path, data, len, offset));
+}
+
+int fs_read_file(fs_t *fs, uint32_t cwd_inode, const char *path, uint8_t *out, size_t len, uint32_t offset, size_t *bytes_read) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_READ, len);
+    return end_call(fs, mark, TRACE_FS_READ, do_read_file(fs, cwd_inode, path, out, len, offset, bytes_read));
+}
+
+int fs_list_dir(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_dirent_disk **out_entries, size_t *out_count) {
+    arena_mark_t mark = arena_mark(&fs->scratch);
+    TRACE(TRACE_FS_OP_BEGIN, TRACE_FS_LIST, 0);
+    return end_call(fs, mark, TRACE_FS_LIST, do_list_dir(fs, cwd_inode, path, out_entries, out_count));
+}
@@ -1,8 +1,10 @@
 #ifndef AIOS_FS_H
 #define AIOS_FS_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "arena.h"
 #include "blockdev.h"
 
 #define FS_MAGIC 0x41494f53u /* "AIOS" */
@@ -10,6 +12,8 @@
 #define FS_DIRECT_BLOCKS 8
 #define FS_MAX_NAME 32
 #define FS_MAX_PATH 512
+#define FS_CSUM_MAGIC 0x4d555343u /* "CSUM" */
+#define FS_CSUM_OFFSET 64u        /* within block 0, after the superblock */
 
 enum fs_inode_type {
     FS_INODE_FREE = 0,
@@ -33,6 +37,19 @@ struct fs_superblock {
     uint32_t root_inode;
 };
 
+/*
+ * Optional CRC32C table in block 0: one entry per metadata block (bitmaps and
+ * inode table, blocks 1..blocks). Images without it, e.g. from fs_shell,
+ * mount without verification.
+ */
+struct fs_csum_header {
+    uint32_t magic;
+    uint32_t blocks;
+    uint32_t crc; /* over the superblock and the table */
+    uint32_t reserved;
+    /* uint32_t crc[blocks] follows */
+};
+
 struct fs_inode {
     uint8_t type; /* fs_inode_type */
     uint8_t reserved[3];
@@ -46,11 +63,27 @@ struct fs_dirent_disk {
     char name[FS_MAX_NAME];
 };
 
+struct slab_cache;
+
+struct fs_stats {
+    uint64_t inode_reads;
+    uint64_t inode_writes;
+    uint64_t bitmap_syncs;
+    uint64_t superblock_writes;
+    uint64_t csum_errors;
+};
+
 typedef struct fs {
     struct blockdev bd;
+    struct slab_cache *block_cache;
+    struct arena scratch; /* per-call temporaries */
     struct fs_superblock sb;
     uint8_t *inode_bitmap;
     uint8_t *data_bitmap;
+    uint32_t *meta_crc;   /* NULL when the image carries no checksums */
+    uint32_t meta_blocks;
+    bool meta_dirty;      /* table changed; block 0 rewritten at end of call */
+    struct fs_stats stats;
 } fs_t;
 
 int fs_format(fs_t *fs, struct blockdev *bd, uint32_t inode_count);
@@ -64,6 +97,6 @@ int fs_create_file(fs_t *fs, uint32_t cwd_inode, const char *path);
 int fs_delete(fs_t *fs, uint32_t cwd_inode, const char *path);
 int fs_write_file(fs_t *fs, uint32_t cwd_inode, const char *path, const uint8_t *data, size_t len, uint32_t offset);
 int fs_read_file(fs_t *fs, uint32_t cwd_inode, const char *path, uint8_t *out, size_t len, uint32_t offset, size_t *bytes_read);
-int fs_list_dir(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_dirent_disk **out_entries, size_t *out_count);
+int fs_list_dir(fs_t *fs, uint32_t cwd_inode, const char *path, struct fs_dirent_disk **out_entries, size_t *out_count); /* caller kfree()s entries */
 
 #endif /* AIOS_FS_H */
@@ -0,0 +1,79 @@
+#include "fsrec.h"
+#include "serial.h"
+#include "util.h"
+
+#define FSREC_MAX_OPS 2048u
+#define FSREC_PATH_MAX 104u /* longer paths are dropped rather than truncated */
+
+struct fsrec_entry {
+    uint64_t ns;
+    uint32_t offset;
+    uint32_t length;
+    int32_t result;
+    uint8_t op;
+    char path[FSREC_PATH_MAX];
+};
+
+static const char *const op_names[] = {
+    [FSREC_MKDIR] = "mkdir",
+    [FSREC_WRITE] = "write",
+    [FSREC_READ] = "read",
+    [FSREC_DELETE] = "delete",
+    [FSREC_LIST] = "list",
+};
+
+static struct fsrec_entry entries[FSREC_MAX_OPS];
+static uint32_t count = 0;
+static uint32_t dropped = 0;
+static bool recording = false;
+
+void fsrec_start(void) {
+    count = 0;
+    dropped = 0;
+    recording = true;
+}
+
+void fsrec_stop(void) { recording = false; }
+
+bool fsrec_active(void) { return recording; }
+
+void fsrec_add(enum fsrec_op op, const char *abs_path, uint32_t offset, uint32_t length, int result, uint64_t ns) {
+    if (!recording) return;
+    while (*abs_path == '/') abs_path++;
+    if (!*abs_path) abs_path = ".";
+    if (count == FSREC_MAX_OPS || strlen(abs_path) >= FSREC_PATH_MAX) {
+        dropped++;
+        return;
+    }
+    struct fsrec_entry *e = &entries[count++];
+    e->ns = ns;
+    e->offset = offset;
+    e->length = length;
+    e->result = result;
+    e->op = (uint8_t)op;
+    strcpy(e->path, abs_path);
+}
+
+void fsrec_dump(void) {
+    serial_write("#fstrace v1 ops=");
+    serial_write_u32(count);
+    serial_write(" dropped=");
+    serial_write_u32(dropped);
+    serial_write("\r\n");
+    for (uint32_t i = 0; i < count; ++i) {
+        const struct fsrec_entry *e = &entries[i];
+        serial_write(op_names[e->op]);
+        serial_write(" ");
+        serial_write(e->path);
+        serial_write(" ");
+        serial_write_u32(e->offset);
+        serial_write(" ");
+        serial_write_u32(e->length);
+        serial_write(e->result < 0 ? " -" : " ");
+        serial_write_u32(e->result < 0 ? (uint32_t)-e->result : (uint32_t)e->result);
+        serial_write(" ");
+        serial_write_u64(e->ns);
+        serial_write("\r\n");
+    }
+    serial_write("#end\r\n");
+}
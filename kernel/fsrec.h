@@ -0,0 +1,33 @@
+#ifndef AIOS_KERNEL_FSREC_H
+#define AIOS_KERNEL_FSREC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Shell-level filesystem workload recorder. Each completed shell file
+ * operation becomes one record; `record dump` prints them in the text
+ * format shared with fs_shell (fs_shell/fstrace.h), which hostbench and
+ * fs_shell can replay:
+ *   #fstrace v1 ops=<n> dropped=<n>
+ *   <op> <path> <offset> <length> <result> <duration ns>
+ *   #end
+ * Paths are relative to the fs root ("." for the root itself).
+ */
+
+enum fsrec_op {
+    FSREC_MKDIR,
+    FSREC_WRITE,   /* length: bytes written */
+    FSREC_READ,    /* length: bytes read */
+    FSREC_DELETE,
+    FSREC_LIST,    /* length: entries */
+};
+
+void fsrec_start(void);  /* clears the buffer and starts recording */
+void fsrec_stop(void);
+bool fsrec_active(void);
+/* abs_path is normalized and starts with '/'. */
+void fsrec_add(enum fsrec_op op, const char *abs_path, uint32_t offset, uint32_t length, int result, uint64_t ns);
+void fsrec_dump(void);
+
+#endif
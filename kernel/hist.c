@@ -0,0 +1,80 @@
+#include "hist.h"
+#include "serial.h"
+
+static unsigned bucket_for(uint64_t ns) {
+    unsigned b = 0;
+    while (ns > 1 && b < HIST_BUCKETS - 1) {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void hist_add(struct hist *h, uint64_t ns) {
+    h->count++;
+    h->sum_ns += ns;
+    if (ns > h->max_ns) h->max_ns = ns;
+    h->buckets[bucket_for(ns)]++;
+}
+
+uint64_t hist_percentile(const struct hist *h, uint32_t permille) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (h->count * permille + 999u) / 1000u; /* 1-based */
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < HIST_BUCKETS; ++b) {
+        uint32_t n = h->buckets[b];
+        if (seen + n < rank) {
+            seen += n;
+            continue;
+        }
+        uint64_t lo = b ? 1ull << b : 0;
+        uint64_t hi = b == HIST_BUCKETS - 1 ? h->max_ns : 1ull << (b + 1);
+        uint64_t est = lo + (hi - lo) * (rank - seen) / n;
+        return est < h->max_ns ? est : h->max_ns;
+    }
+    return h->max_ns;
+}
+
+/* ns below 10 us, us below 10 ms, ms above. */
+static void write_duration(uint64_t ns) {
+    if (ns < 10000u) {
+        serial_write_u64(ns);
+        serial_write("ns");
+    } else if (ns < 10000000u) {
+        serial_write_u64(ns / 1000u);
+        serial_write("us");
+    } else {
+        serial_write_u64(ns / 1000000u);
+        serial_write("ms");
+    }
+}
+
+void hist_print(const char *label, const struct hist *h, int buckets) {
+    serial_write("  ");
+    serial_write(label);
+    serial_write(": n=");
+    serial_write_u64(h->count);
+    if (h->count) {
+        serial_write(" avg ");
+        write_duration(h->sum_ns / h->count);
+        serial_write(" p50 ");
+        write_duration(hist_percentile(h, 500));
+        serial_write(" p90 ");
+        write_duration(hist_percentile(h, 900));
+        serial_write(" p99 ");
+        write_duration(hist_percentile(h, 990));
+        serial_write(" max ");
+        write_duration(h->max_ns);
+    }
+    serial_write("\r\n");
+    if (!buckets) return;
+    for (unsigned b = 0; b < HIST_BUCKETS; ++b) {
+        if (!h->buckets[b]) continue;
+        serial_write("    <");
+        write_duration(2ull << b);
+        serial_write("\t");
+        serial_write_u32(h->buckets[b]);
+        serial_write("\r\n");
+    }
+}
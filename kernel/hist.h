@@ -0,0 +1,22 @@
+#ifndef AIOS_KERNEL_HIST_H
+#define AIOS_KERNEL_HIST_H
+
+#include <stdint.h>
+
+#define HIST_BUCKETS 32 /* bucket i holds [2^i, 2^(i+1)) ns; the last one is open-ended */
+
+/* Log2 latency histogram; zero-initialise to start empty. */
+struct hist {
+    uint64_t count;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+    uint32_t buckets[HIST_BUCKETS];
+};
+
+void hist_add(struct hist *h, uint64_t ns);
+/* Estimated latency at `permille` (500 = p50, 990 = p99), interpolated within a bucket. */
+uint64_t hist_percentile(const struct hist *h, uint32_t permille);
+/* One summary line (count, avg, p50, p90, p99, max), then non-empty buckets if `buckets`. */
+void hist_print(const char *label, const struct hist *h, int buckets);
+
+#endif
@@ -0,0 +1,35 @@
+#include "idle.h"
+#include "cpu.h"
+#include "time.h"
+#include "util.h"
+
+static volatile int halted = 0;
+static volatile uint64_t wake_tsc = 0;
+static struct idle_stats stats;
+
+void cpu_idle(void) {
+    wake_tsc = 0;
+    halted = 1;
+    uint64_t start = rdtsc();
+    __asm__ __volatile__("sti; hlt" : : : "memory");
+    uint64_t now = rdtsc();
+    halted = 0;
+    stats.halts++;
+    uint64_t woke = wake_tsc ? wake_tsc : now; /* NMI/SMI wakeups skip dispatch */
+    uint64_t residency = tsc_to_ns(woke - start);
+    stats.idle_ns += residency;
+    hist_add(&stats.residency, residency);
+    if (wake_tsc) hist_add(&stats.wakeup, tsc_to_ns(now - wake_tsc));
+}
+
+void idle_interrupt(void) {
+    if (halted && !wake_tsc) wake_tsc = rdtsc();
+}
+
+void idle_get_stats(struct idle_stats *out) {
+    *out = stats;
+}
+
+void idle_reset_stats(void) {
+    memset(&stats, 0, sizeof(stats));
+}
@@ -0,0 +1,26 @@
+#ifndef AIOS_KERNEL_IDLE_H
+#define AIOS_KERNEL_IDLE_H
+
+#include <stdint.h>
+#include "hist.h"
+
+struct idle_stats {
+    uint64_t halts;
+    uint64_t idle_ns;      /* time spent halted */
+    struct hist residency; /* hlt until the waking interrupt */
+    struct hist wakeup;    /* waking interrupt's entry until the idle loop runs again */
+};
+
+/*
+ * Halt until the next interrupt. Call with interrupts disabled, after
+ * checking that there is nothing to do: sti;hlt makes the check and the
+ * halt atomic, so a wakeup cannot slip in between. Returns with interrupts
+ * enabled.
+ */
+void cpu_idle(void);
+/* Called by interrupt_dispatch() on every interrupt. */
+void idle_interrupt(void);
+void idle_get_stats(struct idle_stats *out);
+void idle_reset_stats(void);
+
+#endif
@@ -0,0 +1,128 @@
+#include "idt.h"
+#include "cpu.h"
+#include "serial.h"
+#include "idle.h"
+#include "thread.h"
+
+#define IDT_GATE_INTERRUPT 0x8E /* present, DPL 0, 64-bit interrupt gate */
+#define ISR_STUB_SIZE 16
+#define KERNEL_CS 0x08
+#define KERNEL_DS 0x10
+
+struct idt_entry {
+    uint16_t offset_low;
+    uint16_t selector;
+    uint8_t ist;
+    uint8_t type_attr;
+    uint16_t offset_mid;
+    uint32_t offset_high;
+    uint32_t reserved;
+} __attribute__((packed));
+
+struct idt_pointer {
+    uint16_t limit;
+    uint64_t base;
+} __attribute__((packed));
+
+/*
+ * The firmware's GDT sits in boot-services memory that
+ * pmm_reclaim_boot_memory() hands out again, and iretq reloads CS/SS from
+ * it, so switch to our own flat one first.
+ */
+static const uint64_t gdt[3] __attribute__((aligned(16))) = {
+    0,
+    0x00AF9A000000FFFFull, /* KERNEL_CS: 64-bit code, DPL 0 */
+    0x00CF92000000FFFFull, /* KERNEL_DS: data, DPL 0 */
+};
+
+extern const uint8_t isr_stub_table[];
+
+static struct idt_entry idt[IDT_VECTORS] __attribute__((aligned(16)));
+static interrupt_handler_fn handlers[IDT_VECTORS];
+
+static const char *const exception_names[IDT_FIRST_IRQ] = {
+    "divide error", "debug", "NMI", "breakpoint", "overflow", "bound range",
+    "invalid opcode", "device not available", "double fault", "coprocessor overrun",
+    "invalid TSS", "segment not present", "stack fault", "general protection",
+    "page fault", "reserved", "x87 FP", "alignment check", "machine check",
+    "SIMD FP", "virtualization", "control protection",
+};
+
+static void unhandled(struct interrupt_frame *frame) {
+    serial_emergency();
+    serial_write("\r\n[kernel] Unhandled ");
+    if (frame->vector < IDT_FIRST_IRQ) {
+        const char *name = exception_names[frame->vector];
+        serial_write("exception ");
+        serial_write(name ? name : "(reserved)");
+    } else {
+        serial_write("interrupt");
+    }
+    serial_write(" vector ");
+    serial_write_u32((uint32_t)frame->vector);
+    serial_write(" error 0x");
+    serial_write_hex(frame->error);
+    serial_write("\r\n  rip 0x");
+    serial_write_hex(frame->rip);
+    serial_write(" rsp 0x");
+    serial_write_hex(frame->rsp);
+    serial_write(" rbp 0x");
+    serial_write_hex(frame->rbp);
+    if (frame->vector == 14) {
+        serial_write(" cr2 0x");
+        uint64_t cr2;
+        __asm__ __volatile__("mov %%cr2, %0" : "=r"(cr2));
+        serial_write_hex(cr2);
+    }
+    serial_write("\r\n[kernel] Halting\r\n");
+    for (;;) { __asm__ __volatile__("cli; hlt"); }
+}
+
+void interrupt_dispatch(struct interrupt_frame *frame);
+
+void interrupt_dispatch(struct interrupt_frame *frame) {
+    idle_interrupt();
+    interrupt_handler_fn fn = handlers[frame->vector & 0xFF];
+    if (fn) fn(frame);
+    else unhandled(frame);
+    thread_irq_exit(frame);
+}
+
+void idt_set_handler(uint8_t vector, interrupt_handler_fn fn) {
+    handlers[vector] = fn;
+}
+
+static void load_gdt(void) {
+    struct idt_pointer ptr = { .limit = sizeof(gdt) - 1, .base = (uint64_t)(uintptr_t)gdt };
+    __asm__ __volatile__(
+        "lgdt %0\n\t"
+        "pushq %1\n\t"
+        "leaq 1f(%%rip), %%rax\n\t"
+        "pushq %%rax\n\t"
+        "lretq\n"
+        "1:\n\t"
+        "mov %2, %%ds\n\t"
+        "mov %2, %%es\n\t"
+        "mov %2, %%ss\n\t"
+        "mov %2, %%fs\n\t"
+        "mov %2, %%gs"
+        : : "m"(ptr), "i"((uint64_t)KERNEL_CS), "r"((uint64_t)KERNEL_DS) : "rax", "memory");
+}
+
+void idt_init(void) {
+    irq_disable();
+    load_gdt();
+    uint16_t cs = KERNEL_CS;
+    for (int v = 0; v < IDT_VECTORS; ++v) {
+        uint64_t addr = (uint64_t)(uintptr_t)(isr_stub_table + v * ISR_STUB_SIZE);
+        idt[v].offset_low = (uint16_t)addr;
+        idt[v].selector = cs;
+        idt[v].ist = 0;
+        idt[v].type_attr = IDT_GATE_INTERRUPT;
+        idt[v].offset_mid = (uint16_t)(addr >> 16);
+        idt[v].offset_high = (uint32_t)(addr >> 32);
+        idt[v].reserved = 0;
+    }
+    struct idt_pointer ptr = { .limit = sizeof(idt) - 1, .base = (uint64_t)(uintptr_t)idt };
+    __asm__ __volatile__("lidt %0" : : "m"(ptr) : "memory");
+}
@@ -0,0 +1,32 @@
+#ifndef AIOS_KERNEL_IDT_H
+#define AIOS_KERNEL_IDT_H
+
+#include <stdint.h>
+
+#define IDT_VECTORS 256
+#define IDT_FIRST_IRQ 32 /* 0-31 are CPU exceptions */
+
+/* Register state pushed by the stubs in isr.S, lowest address first. */
+struct interrupt_frame {
+    uint64_t r15, r14, r13, r12, r11, r10, r9, r8;
+    uint64_t rbp, rdi, rsi, rdx, rcx, rbx, rax;
+    uint64_t vector;
+    uint64_t error; /* 0 for vectors without a CPU error code */
+    uint64_t rip, cs, rflags, rsp, ss;
+};
+
+/*
+ * Handlers run with interrupts off and with the interrupted code's SIMD
+ * registers live, so they must not call memcpy/memset or anything else
+ * that may use vector registers. Handlers installed here acknowledge their
+ * own controller (lapic_eoi()); device interrupts registered through irq.h
+ * are acknowledged for them. A handler may wake threads; any preemption
+ * that causes happens after it returns.
+ */
+typedef void (*interrupt_handler_fn)(struct interrupt_frame *frame);
+
+/* Load kernel-owned GDT and IDT; unhandled exceptions print the frame and halt. */
+void idt_init(void);
+void idt_set_handler(uint8_t vector, interrupt_handler_fn fn);
+
+#endif
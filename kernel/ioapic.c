@@ -0,0 +1,96 @@
+#include "ioapic.h"
+#include "acpi.h"
+#include "paging.h"
+
+#define IOAPIC_REGSEL    0x00
+#define IOAPIC_WINDOW    0x10
+#define IOAPIC_REG_VER   0x01
+#define IOAPIC_REG_REDIR 0x10 /* two 32-bit registers per pin */
+
+#define REDIR_ACTIVE_LOW (1u << 13)
+#define REDIR_LEVEL      (1u << 15)
+#define REDIR_MASKED     (1u << 16)
+
+struct ioapic {
+    volatile uint32_t *regs;
+    uint32_t gsi_base;
+    uint32_t pins;
+};
+
+static struct ioapic ioapics[ACPI_MAX_IOAPICS];
+static uint32_t ioapic_count = 0;
+
+static uint32_t ioapic_read(const struct ioapic *io, uint32_t reg) {
+    io->regs[IOAPIC_REGSEL / 4] = reg;
+    return io->regs[IOAPIC_WINDOW / 4];
+}
+
+static void ioapic_write(const struct ioapic *io, uint32_t reg, uint32_t value) {
+    io->regs[IOAPIC_REGSEL / 4] = reg;
+    io->regs[IOAPIC_WINDOW / 4] = value;
+}
+
+static const struct ioapic *ioapic_for(uint32_t gsi, uint32_t *pin) {
+    for (uint32_t i = 0; i < ioapic_count; ++i) {
+        const struct ioapic *io = &ioapics[i];
+        if (gsi >= io->gsi_base && gsi < io->gsi_base + io->pins) {
+            *pin = gsi - io->gsi_base;
+            return io;
+        }
+    }
+    return 0;
+}
+
+int ioapic_init(void) {
+    const struct acpi_info *acpi = acpi_get_info();
+    ioapic_count = 0;
+    for (uint32_t i = 0; i < acpi->ioapic_count; ++i) {
+        struct ioapic *io = &ioapics[ioapic_count];
+        uint64_t phys = acpi->ioapics[i].address;
+        paging_map(phys, 0x1000, PAGING_UC); /* fails harmlessly on firmware tables */
+        io->regs = (volatile uint32_t *)(uintptr_t)phys;
+        io->gsi_base = acpi->ioapics[i].gsi_base;
+        io->pins = ((ioapic_read(io, IOAPIC_REG_VER) >> 16) & 0xFFu) + 1u;
+        for (uint32_t pin = 0; pin < io->pins; ++pin) {
+            ioapic_write(io, IOAPIC_REG_REDIR + pin * 2, REDIR_MASKED);
+            ioapic_write(io, IOAPIC_REG_REDIR + pin * 2 + 1, 0);
+        }
+        ioapic_count++;
+    }
+    return ioapic_count ? 0 : -1;
+}
+
+bool ioapic_present(void) { return ioapic_count != 0; }
+
+uint32_t ioapic_gsi_count(void) {
+    uint32_t top = 0;
+    for (uint32_t i = 0; i < ioapic_count; ++i) {
+        uint32_t end = ioapics[i].gsi_base + ioapics[i].pins;
+        if (end > top) top = end;
+    }
+    return top;
+}
+
+int ioapic_route(uint32_t gsi, uint8_t vector, bool active_low, bool level, uint8_t dest_apic_id) {
+    uint32_t pin;
+    const struct ioapic *io = ioapic_for(gsi, &pin);
+    if (!io) return -1;
+    uint32_t low = vector;
+    if (active_low) low |= REDIR_ACTIVE_LOW;
+    if (level) low |= REDIR_LEVEL;
+    /* Destination first, so the entry is complete when it unmasks. */
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2, REDIR_MASKED);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2 + 1, (uint32_t)dest_apic_id << 24);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2, low);
+    return 0;
+}
+
+int ioapic_mask(uint32_t gsi, bool masked) {
+    uint32_t pin;
+    const struct ioapic *io = ioapic_for(gsi, &pin);
+    if (!io) return -1;
+    uint32_t low = ioapic_read(io, IOAPIC_REG_REDIR + pin * 2);
+    low = masked ? (low | REDIR_MASKED) : (low & ~REDIR_MASKED);
+    ioapic_write(io, IOAPIC_REG_REDIR + pin * 2, low);
+    return 0;
+}
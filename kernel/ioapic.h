@@ -0,0 +1,18 @@
+#ifndef AIOS_KERNEL_IOAPIC_H
+#define AIOS_KERNEL_IOAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * I/O APICs listed in the MADT. ioapic_init() needs acpi_init() and masks
+ * every redirection entry; ioapic_route() programs and unmasks one pin.
+ * Everything is delivered to the boot CPU in fixed, physical mode.
+ */
+int ioapic_init(void);
+bool ioapic_present(void);
+uint32_t ioapic_gsi_count(void); /* highest routable GSI + 1 */
+int ioapic_route(uint32_t gsi, uint8_t vector, bool active_low, bool level, uint8_t dest_apic_id);
+int ioapic_mask(uint32_t gsi, bool masked);
+
+#endif
@@ -0,0 +1,58 @@
+#include "irq.h"
+#include "acpi.h"
+#include "ioapic.h"
+#include "lapic.h"
+
+static struct irq_line lines[IRQ_MAX_LINES];
+static uint32_t line_count = 0;
+static struct irq_line *by_vector[IDT_VECTORS];
+static uint8_t next_vector = IRQ_VECTOR_FIRST_DEVICE;
+
+static void irq_entry(struct interrupt_frame *frame) {
+    struct irq_line *line = by_vector[frame->vector & 0xFF];
+    line->count++;
+    line->fn(frame);
+    lapic_eoi();
+}
+
+int irq_register_gsi(uint32_t gsi, bool active_low, bool level, const char *name, interrupt_handler_fn fn) {
+    if (!fn || !lapic_present() || !ioapic_present()) return -1;
+    if (line_count == IRQ_MAX_LINES || next_vector > IRQ_VECTOR_LAST_DEVICE) return -1;
+    for (uint32_t i = 0; i < line_count; ++i) {
+        if (lines[i].gsi == gsi) return -1; /* no sharing */
+    }
+    struct irq_line *line = &lines[line_count];
+    line->name = name;
+    line->gsi = gsi;
+    line->vector = next_vector;
+    line->level = level;
+    line->count = 0;
+    line->fn = fn;
+    by_vector[line->vector] = line;
+    idt_set_handler(line->vector, irq_entry);
+    if (ioapic_route(gsi, line->vector, active_low, level, (uint8_t)lapic_id()) != 0) {
+        by_vector[line->vector] = 0;
+        idt_set_handler(line->vector, 0);
+        return -1;
+    }
+    line_count++;
+    return next_vector++;
+}
+
+int irq_register_isa(uint8_t isa_irq, const char *name, interrupt_handler_fn fn) {
+    uint16_t flags;
+    uint32_t gsi = acpi_isa_gsi(isa_irq, &flags);
+    bool active_low = (flags & ACPI_INTI_POLARITY_MASK) == ACPI_INTI_ACTIVE_LOW;
+    bool level = (flags & ACPI_INTI_TRIGGER_MASK) == ACPI_INTI_LEVEL;
+    return irq_register_gsi(gsi, active_low, level, name, fn);
+}
+
+int irq_set_masked(int vector, bool masked) {
+    if (vector < 0 || vector >= IDT_VECTORS || !by_vector[vector]) return -1;
+    return ioapic_mask(by_vector[vector]->gsi, masked);
+}
+
+const struct irq_line *irq_lines(uint32_t *count) {
+    *count = line_count;
+    return lines;
+}
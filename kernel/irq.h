@@ -0,0 +1,33 @@
+#ifndef AIOS_KERNEL_IRQ_H
+#define AIOS_KERNEL_IRQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "idt.h"
+
+#define IRQ_VECTOR_FIRST_DEVICE 0x30
+#define IRQ_VECTOR_LAST_DEVICE  0xEF
+#define IRQ_MAX_LINES 16
+
+/* One routed device interrupt. */
+struct irq_line {
+    const char *name;
+    uint32_t gsi;
+    uint8_t vector;
+    bool level;
+    uint64_t count;
+    interrupt_handler_fn fn;
+};
+
+/*
+ * Device interrupts through the I/O APIC. Registration picks a free vector,
+ * routes the GSI to the boot CPU and unmasks it; the handler runs with
+ * interrupts off and the LAPIC EOI is sent after it returns. Needs
+ * lapic_init() and ioapic_init(). Returns the vector or -1.
+ */
+int irq_register_isa(uint8_t isa_irq, const char *name, interrupt_handler_fn fn);
+int irq_register_gsi(uint32_t gsi, bool active_low, bool level, const char *name, interrupt_handler_fn fn);
+int irq_set_masked(int vector, bool masked);
+const struct irq_line *irq_lines(uint32_t *count);
+
+#endif
@@ -0,0 +1,24 @@
+#include "ksyms.h"
+
+extern const char __text_start[];
+extern const char __text_end[];
+
+int ksym_index(uint64_t addr) {
+    if (ksym_count == 0) return -1;
+    if (addr < (uint64_t)(uintptr_t)__text_start || addr >= (uint64_t)(uintptr_t)__text_end) return -1;
+    if (addr < ksym_table[0].addr) return -1;
+    uint32_t lo = 0, hi = ksym_count;
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ksym_table[mid].addr <= addr) lo = mid;
+        else hi = mid;
+    }
+    return (int)lo;
+}
+
+const char *ksym_lookup(uint64_t addr, uint64_t *offset) {
+    int idx = ksym_index(addr);
+    if (idx < 0) return 0;
+    if (offset) *offset = addr - ksym_table[idx].addr;
+    return ksym_table[idx].name;
+}
@@ -0,0 +1,24 @@
+#ifndef AIOS_KERNEL_KSYMS_H
+#define AIOS_KERNEL_KSYMS_H
+
+#include <stdint.h>
+
+/*
+ * Kernel text symbols, sorted by address. The table is generated from
+ * kernel.elf by build_kernel in scripts/setup_env.sh (a second link pass),
+ * so it is empty in a kernel linked by anything else.
+ */
+struct ksym {
+    uint64_t addr;
+    const char *name;
+};
+
+extern const struct ksym ksym_table[];
+extern const uint32_t ksym_count;
+
+/* Index of the symbol containing addr, or -1. */
+int ksym_index(uint64_t addr);
+/* Name of the symbol containing addr, or NULL; *offset is addr minus its start. */
+const char *ksym_lookup(uint64_t addr, uint64_t *offset);
+
+#endif
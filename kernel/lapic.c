@@ -0,0 +1,93 @@
+#include "lapic.h"
+#include "cpu.h"
+#include "idt.h"
+#include "io.h"
+#include "paging.h"
+#include "time.h"
+
+#define APIC_BASE_ENABLE   (1ull << 11)
+#define APIC_BASE_ADDR     0xFFFFFF000ull
+
+#define LAPIC_ID           0x020
+#define LAPIC_TPR          0x080
+#define LAPIC_EOI          0x0B0
+#define LAPIC_SVR          0x0F0
+#define LAPIC_LVT_TIMER    0x320
+#define LAPIC_TIMER_INIT   0x380
+#define LAPIC_TIMER_CUR    0x390
+#define LAPIC_TIMER_DIV    0x3E0
+
+#define SVR_ENABLE         (1u << 8)
+#define LVT_MASKED         (1u << 16)
+#define LVT_PERIODIC       (1u << 17)
+#define TIMER_DIV_16       0x3u
+#define CALIBRATE_US       10000u
+
+#define PIC1_DATA 0x21
+#define PIC2_DATA 0xA1
+
+static volatile uint32_t *regs = 0;
+static uint64_t timer_hz = 0;
+
+static uint32_t lapic_read(uint32_t reg) { return regs[reg / 4]; }
+static void lapic_write(uint32_t reg, uint32_t value) { regs[reg / 4] = value; }
+
+static void spurious(struct interrupt_frame *frame) {
+    (void)frame; /* no EOI for spurious vectors */
+}
+
+int lapic_init(void) {
+    /* Everything goes through the LAPIC; keep the 8259s quiet. */
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+
+    if (!cpu_get_features()->apic) return -1;
+    uint64_t base = rdmsr(MSR_IA32_APIC_BASE);
+    if (!(base & APIC_BASE_ENABLE)) wrmsr(MSR_IA32_APIC_BASE, base | APIC_BASE_ENABLE);
+    uint64_t phys = base & APIC_BASE_ADDR;
+    paging_map(phys, 0x1000, PAGING_UC); /* fails harmlessly on firmware tables */
+    regs = (volatile uint32_t *)(uintptr_t)phys;
+
+    idt_set_handler(IRQ_VECTOR_SPURIOUS, spurious);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | IRQ_VECTOR_SPURIOUS);
+
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | IRQ_VECTOR_TIMER);
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFFu);
+    uint64_t t0 = ktime_ns();
+    udelay(CALIBRATE_US);
+    uint32_t elapsed = 0xFFFFFFFFu - lapic_read(LAPIC_TIMER_CUR);
+    uint64_t ns = ktime_ns() - t0;
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    if (elapsed == 0 || ns == 0) return -1;
+    timer_hz = (uint64_t)elapsed * NSEC_PER_SEC / ns;
+    return 0;
+}
+
+bool lapic_present(void) { return regs != 0; }
+
+void lapic_eoi(void) {
+    if (regs) lapic_write(LAPIC_EOI, 0);
+}
+
+uint32_t lapic_id(void) { return regs ? lapic_read(LAPIC_ID) >> 24 : 0; }
+
+int lapic_timer_start(uint32_t hz, uint8_t vector) {
+    if (!regs || !timer_hz || hz == 0) return -1;
+    uint64_t count = timer_hz / hz;
+    if (count == 0) count = 1;
+    if (count > 0xFFFFFFFFu) count = 0xFFFFFFFFu;
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | vector);
+    lapic_write(LAPIC_TIMER_INIT, (uint32_t)count);
+    return 0;
+}
+
+void lapic_timer_stop(void) {
+    if (!regs) return;
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | IRQ_VECTOR_TIMER);
+}
+
+uint64_t lapic_timer_hz(void) { return timer_hz; }
@@ -0,0 +1,24 @@
+#ifndef AIOS_KERNEL_LAPIC_H
+#define AIOS_KERNEL_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define IRQ_VECTOR_TIMER    0x20
+#define IRQ_VECTOR_SPURIOUS 0xFF
+
+/*
+ * Local APIC of the boot CPU. lapic_init() masks the legacy 8259s, enables
+ * the APIC and calibrates its timer against the TSC; needs idt_init() and
+ * time_init(). The timer stays stopped until lapic_timer_start().
+ */
+int lapic_init(void);
+bool lapic_present(void);
+void lapic_eoi(void);
+uint32_t lapic_id(void);
+/* Periodic interrupts on `vector` at roughly `hz`. */
+int lapic_timer_start(uint32_t hz, uint8_t vector);
+void lapic_timer_stop(void);
+uint64_t lapic_timer_hz(void); /* timer input clock after the divider */
+
+#endif
@@ -2,27 +2,85 @@
 #include <stddef.h>
 #include "aios/bootinfo.h"
 #include "kernel/serial.h"
+#include "kernel/boottime.h"
+#include "kernel/cpu.h"
+#include "kernel/crc32c.h"
+#include "kernel/time.h"
 #include "kernel/util.h"
 #include "kernel/mem.h"
+#include "kernel/pmm.h"
+#include "kernel/paging.h"
+#include "kernel/idt.h"
+#include "kernel/lapic.h"
+#include "kernel/acpi.h"
+#include "kernel/ioapic.h"
+#include "kernel/thread.h"
 #include "fs/fs.h"
 #include "kernel/shell.h"
 #include "virtio_blk.h"
 
+#define HEAP_INITIAL_ORDER 8       /* 1 MiB, grown on demand */
+#define RAM_DISK_MIN_ORDER 10      /* 4 MiB */
+#define RAM_DISK_MAX_ORDER 14      /* 64 MiB */
+#define ZERO_POOL_BATCH 8          /* pages zeroed per turn before yielding */
+
+static void *heap_grow(size_t min_bytes, size_t *out_bytes) {
+    size_t want = (size_t)PAGE_SIZE << HEAP_INITIAL_ORDER;
+    if (min_bytes > want) want = min_bytes;
+    unsigned order = pmm_order_for(want);
+    void *region = pmm_alloc_pages(order);
+    if (region) *out_bytes = (size_t)PAGE_SIZE << order;
+    return region;
+}
+
+static struct wait_queue zero_pool_wait;
+
+static void zero_pool_kick(void) {
+    wait_queue_wake_one(&zero_pool_wait);
+}
+
+/* Keeps the zeroed-page pool topped up behind the shell, a batch per turn. */
+static void zero_pool_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        if (pmm_zero_pool_refill(ZERO_POOL_BATCH) == 0) {
+            /* Re-check with IRQs off so a kick between refill and wait is not lost. */
+            irq_disable();
+            if (!pmm_zero_pool_needs_refill()) {
+                wait_queue_wait(&zero_pool_wait);
+            } else {
+                irq_enable();
+                thread_yield();
+            }
+        } else {
+            thread_yield();
+        }
+    }
+}
+
+/* Size the fallback RAM disk at roughly 1/16th of free memory. */
+static unsigned ram_disk_order(void) {
+    struct pmm_stats stats;
+    pmm_get_stats(&stats);
+    unsigned order = RAM_DISK_MIN_ORDER;
+    while (order < RAM_DISK_MAX_ORDER && (2ull << order) * 16 <= stats.free_pages) order++;
+    return order;
+}
+
 static uint32_t checksum_bootinfo(const struct aios_boot_info *boot) {
     struct aios_boot_info tmp = *boot;
     tmp.checksum = 0;
-    const uint32_t *words = (const uint32_t *)&tmp;
-    size_t count = sizeof(tmp) / sizeof(uint32_t);
-    uint32_t sum = 0;
-    for (size_t i = 0; i < count; ++i) {
-        sum ^= words[i];
-    }
-    return sum;
+    return crc32c(0, &tmp, sizeof(tmp));
 }
 
 void kernel_entry(struct aios_boot_info *boot) {
+    uint64_t entry_tsc = rdtsc();
     serial_init();
-    serial_write("[kernel] Firmware -> Loader -> Kernel -> [paging soon]\r\n");
+    cpu_init();
+    string_ops_init();
+    int clock_ok = time_init();
+    idt_init();
+    serial_write("[kernel] Firmware -> Loader -> Kernel\r\n");
     serial_write("[kernel] Stage: kernel entry\r\n");
 
     if (boot == 0) {
@@ -31,16 +89,31 @@ void kernel_entry(struct aios_boot_info *boot) {
     }
 
     uint32_t expected = checksum_bootinfo(boot);
-    if (boot->magic != AIOS_BOOTINFO_MAGIC || boot->checksum != expected) {
-        serial_write("[kernel] Boot info validation FAILED\r\n");
-    } else {
-        serial_write("[kernel] Boot info validation OK\r\n");
-    }
+    bool boot_valid = boot->magic == AIOS_BOOTINFO_MAGIC && boot->version == AIOS_BOOTINFO_VERSION && boot->checksum == expected;
+    serial_write(boot_valid ? "[kernel] Boot info validation OK\r\n" : "[kernel] Boot info validation FAILED\r\n");
+    boottime_init(boot_valid ? boot : NULL, entry_tsc);
+    boottime_mark("serial, cpu, clock");
 
     serial_write("[kernel] Accel: ");
     serial_write(boot->accel_mode);
     serial_write("\r\n");
 
+    serial_write("[kernel] CPU: ");
+    serial_write(cpu_get_features()->vendor);
+    serial_write(" string ops: ");
+    serial_write(string_ops_name());
+    serial_write(cpu_get_features()->avx_enabled ? " simd: sse+avx" : " simd: sse");
+    serial_write(" state ");
+    serial_write_u32(cpu_get_features()->simd_state_size);
+    serial_write(" bytes\r\n");
+
+    serial_write("[kernel] Clock: TSC ");
+    serial_write_u32((uint32_t)(time_tsc_hz() / 1000000u));
+    serial_write(" MHz via ");
+    serial_write(time_source_name());
+    if (clock_ok != 0) serial_write(" (calibration failed)");
+    serial_write(cpu_get_features()->invariant_tsc ? ", invariant\r\n" : ", not invariant\r\n");
+
     serial_write("[kernel] Kernel load base: 0x");
     serial_write_hex(boot->kernel_base);
     serial_write(" size: 0x");
@@ -84,13 +157,104 @@ void kernel_entry(struct aios_boot_info *boot) {
     serial_write("\r\n");
     serial_write("Welcome to AIOS — minimal hardware, maximal clarity.\r\n\r\n");
 
-    /* Initialize bump heap */
-    static uint8_t heap_area[256 * 1024];
-    mem_init(heap_area, sizeof(heap_area));
+    if (pmm_init(boot) != 0) {
+        serial_write("[kernel] Page allocator init failed; halting\r\n");
+        goto halt;
+    }
+
+    if (paging_init(boot) == 0) {
+        struct paging_stats vm;
+        paging_get_stats(&vm);
+        serial_write("[kernel] Paging: identity map to 0x");
+        serial_write_hex(vm.mapped_bytes);
+        serial_write(" (1G ");
+        serial_write_u32(vm.pages_1g);
+        serial_write(", 2M ");
+        serial_write_u32(vm.pages_2m);
+        serial_write(", 4K ");
+        serial_write_u32(vm.pages_4k);
+        serial_write(")\r\n");
+        pmm_reclaim_boot_memory(boot);
+    } else {
+        serial_write("[kernel] Paging setup failed; staying on firmware tables, boot memory not reclaimed\r\n");
+    }
+
+    if (lapic_init() == 0) {
+        serial_write("[kernel] LAPIC: id ");
+        serial_write_u32(lapic_id());
+        serial_write(", timer ");
+        serial_write_u32((uint32_t)(lapic_timer_hz() / 1000u));
+        serial_write(" kHz; 8259 masked\r\n");
+    } else {
+        serial_write("[kernel] LAPIC unavailable; timer interrupts disabled\r\n");
+    }
+    if (acpi_init(boot->rsdp_address) == 0 && ioapic_init() == 0) {
+        const struct acpi_info *acpi = acpi_get_info();
+        serial_write("[kernel] ACPI ");
+        serial_write(acpi->oem);
+        serial_write(": ");
+        serial_write_u32(acpi->cpu_count);
+        serial_write(" CPU(s), ");
+        serial_write_u32(acpi->ioapic_count);
+        serial_write(" IOAPIC(s) with ");
+        serial_write_u32(ioapic_gsi_count());
+        serial_write(" GSIs, ");
+        serial_write_u32(acpi->override_count);
+        serial_write(" ISA overrides\r\n");
+        if (serial_enable_irq() == 0) serial_write("[kernel] Serial: COM1 interrupt-driven (TX/RX rings)\r\n");
+    } else {
+        serial_write("[kernel] No usable MADT/IOAPIC; device interrupts disabled\r\n");
+    }
+    irq_enable();
+    boottime_mark("page allocator, paging, interrupts");
+
+    struct pmm_stats pstats;
+    pmm_get_stats(&pstats);
+    serial_write("[kernel] Page allocator: 0x");
+    serial_write_hex(pstats.free_pages);
+    serial_write(" free pages (0x");
+    serial_write_hex(pstats.reclaimed_pages);
+    serial_write(" reclaimed from loader/boot services)\r\n");
 
-    static uint8_t fs_fallback[4 * 1024 * 1024];
-    void *seed_base = (boot->fs_image_base && boot->fs_image_size) ? (void *)(uintptr_t)boot->fs_image_base : fs_fallback;
-    uint32_t seed_bytes = (boot->fs_image_base && boot->fs_image_size) ? (uint32_t)boot->fs_image_size : (uint32_t)sizeof(fs_fallback);
+    void *heap_base = pmm_alloc_pages(HEAP_INITIAL_ORDER);
+    if (!heap_base) {
+        serial_write("[kernel] Heap allocation failed; halting\r\n");
+        goto halt;
+    }
+    mem_init(heap_base, (size_t)PAGE_SIZE << HEAP_INITIAL_ORDER);
+    mem_set_grow(heap_grow);
+    boottime_mark("heap");
+
+    if (thread_init("shell", THREAD_PRIO_HIGH) == 0 &&
+        thread_create("zero-pool", THREAD_PRIO_LOW, zero_pool_worker, NULL)) {
+        pmm_set_zero_pool_hook(zero_pool_kick);
+        serial_write("[kernel] Threads: shell, idle, zero-pool; ");
+        if (thread_timer_start(THREAD_TICK_HZ) == 0) {
+            serial_write("preemptive, ");
+            serial_write_u32(THREAD_TICK_HZ);
+            serial_write(" Hz tick, ");
+            serial_write_u32(THREAD_QUANTUM_MS_DEFAULT);
+            serial_write(" ms quantum\r\n");
+        } else {
+            serial_write("cooperative (no LAPIC timer)\r\n");
+        }
+    } else {
+        serial_write("[kernel] Thread setup failed; running single-threaded\r\n");
+    }
+
+    bool have_seed = boot->fs_image_base && boot->fs_image_size;
+    void *seed_base = have_seed ? (void *)(uintptr_t)boot->fs_image_base : NULL;
+    uint32_t seed_bytes = have_seed ? (uint32_t)boot->fs_image_size : 0;
+    if (!have_seed) {
+        unsigned order = ram_disk_order();
+        seed_base = pmm_alloc_pages(order);
+        seed_bytes = (uint32_t)((size_t)PAGE_SIZE << order);
+        if (!seed_base) {
+            serial_write("[kernel] RAM disk allocation failed; halting\r\n");
+            goto halt;
+        }
+        memset(seed_base, 0, FS_DEFAULT_BLOCK_SIZE); /* no stale superblock */
+    }
 
     struct storage_state storage;
     memset(&storage, 0, sizeof(storage));
@@ -99,11 +263,14 @@ void kernel_entry(struct aios_boot_info *boot) {
         serial_write("[kernel] RAM disk init failed\r\n");
         goto halt;
     }
-    storage.ram_seed_present = (boot->fs_image_base && boot->fs_image_size);
+    storage.ram_seed_present = have_seed;
     storage.ram_seed_blocks = storage.ram_dev.blocks;
     storage.ram_seed_block_size = storage.ram_dev.block_size;
+    boottime_mark("RAM disk");
 
-    if (virtio_blk_init(&storage.virtio) == 0) {
+    int virtio_rc = virtio_blk_init(&storage.virtio);
+    boottime_mark("virtio probe");
+    if (virtio_rc == 0) {
         serial_write("[kernel] Virtio block controller detected\r\n");
         if (bd_init_virtio(&storage.virtio_dev, &storage.virtio, FS_DEFAULT_BLOCK_SIZE) == 0) {
             storage.virtio_present = true;
@@ -113,7 +280,13 @@ void kernel_entry(struct aios_boot_info *boot) {
                 storage.using_ram = false;
             } else {
                 storage.needs_format = true;
-                serial_write("[kernel] Virtio disk present but needs format\r\n");
+                if (storage.fs.stats.csum_errors) {
+                    serial_write("[kernel] Virtio disk failed metadata checksum (");
+                    serial_write_u64(storage.fs.stats.csum_errors);
+                    serial_write(" errors); needs format\r\n");
+                } else {
+                    serial_write("[kernel] Virtio disk present but needs format\r\n");
+                }
             }
         } else {
             serial_write("[kernel] Virtio block init failed after detection\r\n");
@@ -135,6 +308,8 @@ void kernel_entry(struct aios_boot_info *boot) {
         storage.active_dev = &storage.ram_dev;
         serial_write("[kernel] Using RAM-backed filesystem\r\n");
     }
+    boottime_mark("mount");
+    boottime_print();
 
     struct shell_env env = {
         .storage = &storage,
@@ -1,53 +1,378 @@
 #include "mem.h"
+#include "thread.h"
+#include "util.h"
 
-static uint8_t *heap_base = NULL;
+/*
+ * Segregated-fit heap with boundary tags.
+ *
+ * Every block starts with a 16-byte header whose first word stores the block
+ * size (header included) plus two flag bits. Free blocks additionally carry
+ * list links in their payload and a footer copy of the size in their last
+ * word, so kfree() can coalesce with both neighbours in O(1). Free blocks are
+ * kept in power-of-two size-class bins; allocation searches first-fit starting
+ * at the request's bin, so the head of any larger bin is normally taken.
+ *
+ * Each region ends with a zero-sized "used" epilogue header so coalescing
+ * never walks past the end of the memory it was given. When no block fits,
+ * the optional grow callback is asked for another region.
+ *
+ * With tracking enabled, each allocation is charged to the return address of
+ * the public entry point that made it. The site slot is kept in the block
+ * header so kfree() can credit the same site.
+ *
+ * Threads share one heap, so allocation and free run with preemption off.
+ */
+
+#define HEAP_ALIGN      16u
+#define HDR_SIZE        16u
+#define MIN_BLOCK       48u /* header + links + footer, rounded to HEAP_ALIGN */
+#define FLAG_USED       0x1u
+#define FLAG_PREV_USED  0x2u
+#define FLAG_MASK       0xFu
+#define HEAP_BINS       24
+
+struct block {
+    size_t info;     /* size | flags */
+    size_t tag;      /* used blocks: tracking site slot << 32 | requested bytes */
+    /* free blocks only: */
+    struct block *next;
+    struct block *prev;
+};
+
+static struct block *bins[HEAP_BINS];
 static size_t heap_size = 0;
-static size_t heap_offset = 0;
+static size_t heap_used = 0;
+static size_t heap_used_blocks = 0;
+static uint64_t heap_allocs = 0;
+static uint64_t heap_frees = 0;
+static uint64_t heap_failures = 0;
+static mem_grow_fn heap_grow = NULL;
+
+static int track_enabled = 0;
+static struct mem_track_site track_sites[MEM_TRACK_SITES];
+static uint32_t track_site_count = 0;
+static uint64_t track_hist[MEM_TRACK_HIST_BUCKETS];
 
 static size_t align_up(size_t value, size_t alignment) {
     if (alignment == 0) return value;
     return (value + alignment - 1) & ~(alignment - 1);
 }
 
+static size_t block_size(const struct block *b) { return b->info & ~(size_t)FLAG_MASK; }
+static int block_used(const struct block *b) { return (b->info & FLAG_USED) != 0; }
+static int prev_used(const struct block *b) { return (b->info & FLAG_PREV_USED) != 0; }
+
+static struct block *block_next(struct block *b) {
+    return (struct block *)((uint8_t *)b + block_size(b));
+}
+
+static struct block *block_prev(struct block *b) {
+    size_t prev_size = *((size_t *)b - 1);
+    return (struct block *)((uint8_t *)b - prev_size);
+}
+
+static void *block_payload(struct block *b) { return (uint8_t *)b + HDR_SIZE; }
+static struct block *payload_block(void *ptr) { return (struct block *)((uint8_t *)ptr - HDR_SIZE); }
+
+static void set_footer(struct block *b) {
+    size_t size = block_size(b);
+    *(size_t *)((uint8_t *)b + size - sizeof(size_t)) = size;
+}
+
+static void set_prev_used(struct block *b, int used) {
+    if (used) b->info |= FLAG_PREV_USED;
+    else b->info &= ~(size_t)FLAG_PREV_USED;
+}
+
+static int bin_index(size_t size) {
+    int idx = 0;
+    size_t s = size / MIN_BLOCK;
+    while (s > 1 && idx < HEAP_BINS - 1) {
+        s >>= 1;
+        idx++;
+    }
+    return idx;
+}
+
+static void bin_insert(struct block *b) {
+    int idx = bin_index(block_size(b));
+    b->prev = NULL;
+    b->next = bins[idx];
+    if (bins[idx]) bins[idx]->prev = b;
+    bins[idx] = b;
+}
+
+static void bin_remove(struct block *b) {
+    if (b->prev) {
+        b->prev->next = b->next;
+    } else {
+        bins[bin_index(block_size(b))] = b->next;
+    }
+    if (b->next) b->next->prev = b->prev;
+}
+
+/* Mark a block free, merge it with free neighbours and file it in a bin. */
+static void release_block(struct block *b) {
+    b->info &= ~(size_t)FLAG_USED; /* stays visible if b merges into its predecessor */
+    size_t size = block_size(b);
+    struct block *next = block_next(b);
+    if (!block_used(next)) {
+        bin_remove(next);
+        size += block_size(next);
+    }
+    if (!prev_used(b)) {
+        struct block *prev = block_prev(b);
+        bin_remove(prev);
+        size += block_size(prev);
+        b = prev;
+    }
+    b->info = size | FLAG_PREV_USED; /* a free block's predecessor is always used after merging */
+    set_footer(b);
+    set_prev_used(block_next(b), 0);
+    bin_insert(b);
+}
+
+/* Shrink a used block to `size`, returning any worthwhile tail to the bins. */
+static void split_tail(struct block *b, size_t size) {
+    size_t have = block_size(b);
+    if (have - size < MIN_BLOCK) return;
+    b->info = size | (b->info & FLAG_MASK);
+    struct block *tail = (struct block *)((uint8_t *)b + size);
+    tail->info = (have - size) | FLAG_USED | FLAG_PREV_USED;
+    release_block(tail);
+}
+
+static struct block *find_fit(size_t size) {
+    for (int i = bin_index(size); i < HEAP_BINS; ++i) {
+        for (struct block *b = bins[i]; b; b = b->next) {
+            if (block_size(b) >= size) return b;
+        }
+    }
+    return NULL;
+}
+
+static void add_region(void *base, size_t bytes) {
+    uintptr_t start = align_up((uintptr_t)base, HEAP_ALIGN);
+    uintptr_t end = ((uintptr_t)base + bytes) & ~((uintptr_t)HEAP_ALIGN - 1);
+    if (end <= start || end - start < MIN_BLOCK + HDR_SIZE) return;
+
+    size_t usable = (size_t)(end - start) - HDR_SIZE;
+    struct block *b = (struct block *)start;
+    struct block *epilogue = (struct block *)(end - HDR_SIZE);
+    epilogue->info = 0 | FLAG_USED;
+    b->info = usable | FLAG_PREV_USED;
+    set_footer(b);
+    bin_insert(b);
+    heap_size += usable;
+}
+
+static uint32_t hist_bucket(size_t bytes) {
+    uint32_t bucket = 0;
+    while (bucket < MEM_TRACK_HIST_BUCKETS - 1 && ((size_t)16 << bucket) < bytes) bucket++;
+    return bucket;
+}
+
+/* Returns slot + 1 for the caller, or 0 when untracked. The last slot
+ * collects every call site that did not fit in the table. */
+static uint32_t track_site_for(uintptr_t caller) {
+    for (uint32_t i = 0; i < track_site_count; ++i) {
+        if (track_sites[i].caller == caller) return i + 1;
+    }
+    if (track_site_count < MEM_TRACK_SITES) {
+        struct mem_track_site *site = &track_sites[track_site_count++];
+        memset(site, 0, sizeof(*site));
+        site->caller = (track_site_count == MEM_TRACK_SITES) ? 0 : caller;
+        return track_site_count;
+    }
+    return MEM_TRACK_SITES;
+}
+
+static void track_alloc(struct block *b, size_t bytes, uintptr_t caller) {
+    uint32_t slot = 0;
+    if (track_enabled) {
+        slot = track_site_for(caller);
+        struct mem_track_site *site = &track_sites[slot - 1];
+        site->allocs++;
+        site->live_bytes += bytes;
+        site->live_count++;
+        if (site->live_bytes > site->peak_bytes) site->peak_bytes = site->live_bytes;
+        if (site->live_count > site->peak_count) site->peak_count = site->live_count;
+        track_hist[hist_bucket(bytes)]++;
+    }
+    b->tag = ((size_t)slot << 32) | (uint32_t)bytes;
+}
+
+static void track_free(struct block *b) {
+    uint32_t slot = (uint32_t)(b->tag >> 32);
+    if (slot == 0 || slot > track_site_count) return;
+    struct mem_track_site *site = &track_sites[slot - 1];
+    site->frees++;
+    site->live_bytes -= (uint32_t)b->tag;
+    site->live_count--;
+}
+
+void mem_track_enable(int on) {
+    track_enabled = on;
+}
+
+int mem_track_enabled(void) {
+    return track_enabled;
+}
+
+/* Live figures describe blocks that still exist, so they survive a reset. */
+void mem_track_reset(void) {
+    for (uint32_t i = 0; i < track_site_count; ++i) {
+        struct mem_track_site *site = &track_sites[i];
+        site->allocs = 0;
+        site->frees = 0;
+        site->peak_bytes = site->live_bytes;
+        site->peak_count = site->live_count;
+    }
+    for (uint32_t i = 0; i < MEM_TRACK_HIST_BUCKETS; ++i) track_hist[i] = 0;
+}
+
+const struct mem_track_site *mem_track_sites(uint32_t *count) {
+    *count = track_site_count;
+    return track_sites;
+}
+
+const uint64_t *mem_track_histogram(void) {
+    return track_hist;
+}
+
+void mem_add_region(void *base, size_t bytes) {
+    add_region(base, bytes);
+}
+
+void mem_set_grow(mem_grow_fn fn) {
+    heap_grow = fn;
+}
+
 void mem_init(void *base, size_t bytes) {
-    heap_base = (uint8_t *)base;
-    heap_size = bytes;
-    heap_offset = 0;
+    for (int i = 0; i < HEAP_BINS; ++i) bins[i] = NULL;
+    heap_size = 0;
+    heap_used = 0;
+    heap_used_blocks = 0;
+    heap_allocs = 0;
+    heap_frees = 0;
+    heap_failures = 0;
+    add_region(base, bytes);
+}
+
+void mem_reset_counters(void) {
+    heap_allocs = 0;
+    heap_frees = 0;
+    heap_failures = 0;
+}
+
+static void *heap_alloc(size_t bytes, size_t alignment, uintptr_t caller) {
+    if (bytes == 0) return NULL;
+    if (alignment < HEAP_ALIGN) alignment = HEAP_ALIGN;
+    size_t need = align_up(bytes + HDR_SIZE, HEAP_ALIGN);
+    if (need < MIN_BLOCK) need = MIN_BLOCK;
+    /* Over-aligned requests may have to carve a free fragment off the front. */
+    size_t search = (alignment > HEAP_ALIGN) ? need + alignment + MIN_BLOCK : need;
+
+    preempt_disable();
+    struct block *b = find_fit(search);
+    if (!b && heap_grow) {
+        size_t got = 0;
+        void *region = heap_grow(search + 2 * HDR_SIZE + HEAP_ALIGN, &got);
+        if (region) {
+            add_region(region, got);
+            b = find_fit(search);
+        }
+    }
+    if (!b) {
+        heap_failures++;
+        preempt_enable();
+        return NULL;
+    }
+    bin_remove(b);
+    b->info |= FLAG_USED;
+    set_prev_used(block_next(b), 1);
+
+    if (alignment > HEAP_ALIGN) {
+        uintptr_t payload = (uintptr_t)block_payload(b);
+        uintptr_t aligned = align_up(payload, alignment);
+        if (aligned != payload) {
+            if (aligned - payload < MIN_BLOCK) aligned = align_up(payload + MIN_BLOCK, alignment);
+            size_t lead = (size_t)(aligned - payload);
+            struct block *front = b;
+            size_t total = block_size(b);
+            b = (struct block *)((uint8_t *)b + lead);
+            b->info = (total - lead) | FLAG_USED;
+            front->info = lead | FLAG_USED | (front->info & FLAG_PREV_USED);
+            release_block(front);
+        }
+    }
+
+    split_tail(b, need);
+    track_alloc(b, bytes, caller);
+    heap_used += block_size(b);
+    heap_used_blocks++;
+    heap_allocs++;
+    preempt_enable();
+    return block_payload(b);
 }
 
 void *kalloc_aligned(size_t bytes, size_t alignment) {
-    if (!heap_base || bytes == 0) return NULL;
-    alignment = alignment ? alignment : 8;
-    size_t offset = align_up(heap_offset, alignment);
-    if (offset + bytes > heap_size) return NULL;
-    void *ptr = heap_base + offset;
-    heap_offset = offset + align_up(bytes, 8);
-    return ptr;
+    return heap_alloc(bytes, alignment, (uintptr_t)__builtin_return_address(0));
 }
 
 void *kalloc(size_t bytes) {
-    return kalloc_aligned(bytes, 8);
+    return heap_alloc(bytes, HEAP_ALIGN, (uintptr_t)__builtin_return_address(0));
 }
 
 void *kcalloc(size_t count, size_t size) {
+    if (size && count > (size_t)-1 / size) return NULL;
     size_t total = count * size;
-    uint8_t *ptr = (uint8_t *)kalloc(total);
-    if (ptr) {
-        for (size_t i = 0; i < total; ++i) {
-            ptr[i] = 0;
-        }
-    }
+    void *ptr = heap_alloc(total, HEAP_ALIGN, (uintptr_t)__builtin_return_address(0));
+    if (ptr) memset(ptr, 0, total);
     return ptr;
 }
 
 void kfree(void *ptr) {
-    (void)ptr;
+    if (!ptr) return;
+    struct block *b = payload_block(ptr);
+    preempt_disable();
+    if (block_used(b)) { /* double free; ignore rather than corrupt the bins */
+        track_free(b);
+        heap_used -= block_size(b);
+        heap_used_blocks--;
+        heap_frees++;
+        release_block(b);
+    }
+    preempt_enable();
 }
 
 size_t mem_used(void) {
-    return heap_offset;
+    return heap_used;
 }
 
 size_t mem_total(void) {
     return heap_size;
 }
+
+void mem_get_stats(struct mem_stats *out) {
+    out->total_bytes = heap_size;
+    out->used_bytes = heap_used;
+    out->free_bytes = heap_size - heap_used;
+    out->used_blocks = heap_used_blocks;
+    out->free_blocks = 0;
+    out->largest_free = 0;
+    for (int i = 0; i < HEAP_BINS; ++i) {
+        for (struct block *b = bins[i]; b; b = b->next) {
+            out->free_blocks++;
+            if (block_size(b) > out->largest_free) out->largest_free = block_size(b);
+        }
+    }
+    out->allocs = heap_allocs;
+    out->frees = heap_frees;
+    out->failures = heap_failures;
+}
+
+uint32_t mem_fragmentation_pct(const struct mem_stats *stats) {
+    if (stats->free_bytes == 0) return 0;
+    return (uint32_t)(100u - (stats->largest_free * 100u) / stats->free_bytes);
+}
@@ -4,12 +4,51 @@
 #include <stddef.h>
 #include <stdint.h>
 
+struct mem_stats {
+    size_t total_bytes;
+    size_t used_bytes;   /* live blocks, headers included */
+    size_t free_bytes;
+    size_t largest_free;
+    size_t used_blocks;
+    size_t free_blocks;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t failures;
+};
+
+#define MEM_TRACK_SITES 64
+#define MEM_TRACK_HIST_BUCKETS 16 /* <=16 B, <=32 B, ... <=256 KiB, larger */
+
+struct mem_track_site {
+    uintptr_t caller; /* return address of the kalloc/kcalloc/kalloc_aligned call */
+    uint64_t allocs;
+    uint64_t frees;
+    size_t live_bytes;
+    size_t peak_bytes;
+    uint32_t live_count;
+    uint32_t peak_count;
+};
+
+/* Returns a new region of at least min_bytes (size in *out_bytes) or NULL. */
+typedef void *(*mem_grow_fn)(size_t min_bytes, size_t *out_bytes);
+
 void mem_init(void *base, size_t bytes);
+void mem_add_region(void *base, size_t bytes);
+void mem_set_grow(mem_grow_fn fn);
 void *kalloc(size_t bytes);
 void *kcalloc(size_t count, size_t size);
-void kfree(void *ptr); /* no-op in bump allocator */
+void kfree(void *ptr);
 void *kalloc_aligned(size_t bytes, size_t alignment);
 size_t mem_used(void);
 size_t mem_total(void);
+void mem_get_stats(struct mem_stats *out);
+void mem_reset_counters(void); /* allocs, frees, failures */
+uint32_t mem_fragmentation_pct(const struct mem_stats *stats);
+
+void mem_track_enable(int on);
+int mem_track_enabled(void);
+void mem_track_reset(void);
+const struct mem_track_site *mem_track_sites(uint32_t *count);
+const uint64_t *mem_track_histogram(void);
 
 #endif
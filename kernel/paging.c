@@ -0,0 +1,222 @@
+#include "paging.h"
+#include "cpu.h"
+#include "efi.h"
+#include "pmm.h"
+#include "util.h"
+
+/*
+ * Identity map of physical memory, built by the kernel instead of inheriting
+ * whatever the firmware left in CR3.
+ *
+ * Each naturally aligned 1 GiB / 2 MiB / 4 KiB span takes the largest page
+ * whose whole range has one cache type: RAM from the memory map is
+ * write-back, the framebuffer is write-combining, and everything else (MMIO,
+ * firmware-reserved ranges, holes where PCI BARs live) is uncached. Only
+ * spans that straddle a boundary are split into smaller pages.
+ *
+ * The PAT is reprogrammed so that entry 1 (PWT) selects WC; entry 3
+ * (PCD|PWT) stays UC and entry 0 stays WB.
+ */
+
+#define PTE_PRESENT  (1ull << 0)
+#define PTE_WRITE    (1ull << 1)
+#define PTE_PWT      (1ull << 3)
+#define PTE_PCD      (1ull << 4)
+#define PTE_LARGE    (1ull << 7)
+#define PTE_ADDR     0x000FFFFFFFFFF000ull
+
+#define SIZE_1G (1ull << 30)
+#define MIN_MAPPED (4ull << 30) /* always cover the 32-bit MMIO hole */
+
+#define PAT_DEFAULT_WC 0x0007040600070106ull /* WB, WC, UC-, UC, WB, WT, UC-, UC */
+
+#define CACHE_MIXED -1
+
+static uint64_t *pml4 = NULL;
+static const struct aios_boot_info *map_boot = NULL;
+static uint64_t fb_start = 0;
+static uint64_t fb_end = 0;
+static bool has_1g = false;
+static bool has_pat = false;
+static uint64_t mapped_bytes = 0;
+static uint32_t leaf_count[4]; /* indexed by level: 1 = 4 KiB, 2 = 2 MiB, 3 = 1 GiB */
+static uint32_t table_pages = 0;
+
+static uint64_t level_size(unsigned level) { return 1ull << (12 + 9 * (level - 1)); }
+static unsigned level_index(uint64_t addr, unsigned level) { return (unsigned)(addr >> (12 + 9 * (level - 1))) & 511u; }
+
+static int ram_type(uint32_t type) {
+    switch (type) {
+    case EFI_LOADER_CODE:
+    case EFI_LOADER_DATA:
+    case EFI_BOOT_SERVICES_CODE:
+    case EFI_BOOT_SERVICES_DATA:
+    case EFI_RUNTIME_CODE:
+    case EFI_RUNTIME_DATA:
+    case EFI_CONVENTIONAL_MEMORY:
+    case EFI_ACPI_RECLAIM:
+    case EFI_ACPI_NVS:
+    case EFI_PERSISTENT_MEMORY:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static uint64_t overlap(uint64_t a0, uint64_t a1, uint64_t b0, uint64_t b1) {
+    uint64_t lo = a0 > b0 ? a0 : b0;
+    uint64_t hi = a1 < b1 ? a1 : b1;
+    return hi > lo ? hi - lo : 0;
+}
+
+/* Cache type for [start, start + size), or CACHE_MIXED if it is not uniform. */
+static int classify(uint64_t start, uint64_t size) {
+    uint64_t end = start + size;
+    uint64_t fb = overlap(start, end, fb_start, fb_end);
+    if (fb == size) return PAGING_WC;
+    if (fb) return size == PAGE_SIZE ? PAGING_UC : CACHE_MIXED;
+
+    uint64_t ram = 0;
+    uint64_t entries = efi_descriptor_count(map_boot);
+    for (uint64_t i = 0; i < entries; ++i) {
+        const struct efi_memory_descriptor *d = efi_descriptor(map_boot, i);
+        if (ram_type(d->type)) ram += overlap(start, end, d->physical_start, efi_descriptor_end(d));
+    }
+    if (ram >= size) return PAGING_WB;
+    if (ram == 0 || size == PAGE_SIZE) return PAGING_UC;
+    return CACHE_MIXED;
+}
+
+static uint64_t cache_bits(int cache) {
+    if (cache == PAGING_WB) return 0;
+    if (cache == PAGING_WC && has_pat) return PTE_PWT;
+    return PTE_PCD | PTE_PWT;
+}
+
+static uint64_t *alloc_table(void) {
+    uint64_t *table = (uint64_t *)pmm_alloc_zeroed_pages(0);
+    if (table) table_pages++;
+    return table;
+}
+
+static void free_table(uint64_t *table, unsigned level) {
+    for (unsigned i = 0; i < 512; ++i) {
+        uint64_t e = table[i];
+        if (!(e & PTE_PRESENT)) continue;
+        if (level == 1 || (e & PTE_LARGE)) leaf_count[level]--;
+        else free_table((uint64_t *)(uintptr_t)(e & PTE_ADDR), level - 1);
+    }
+    pmm_free_pages(table, 0);
+    table_pages--;
+}
+
+static void set_leaf(uint64_t *entry, unsigned level, uint64_t value) {
+    uint64_t old = *entry;
+    if (old & PTE_PRESENT) {
+        if (level == 1 || (old & PTE_LARGE)) leaf_count[level]--;
+        else free_table((uint64_t *)(uintptr_t)(old & PTE_ADDR), level - 1);
+    }
+    *entry = value;
+    leaf_count[level]++;
+}
+
+/* Next-level table under `entry`, allocating it or splitting a large page. */
+static uint64_t *descend(uint64_t *entry, unsigned level) {
+    uint64_t e = *entry;
+    if ((e & PTE_PRESENT) && !(e & PTE_LARGE)) return (uint64_t *)(uintptr_t)(e & PTE_ADDR);
+    uint64_t *table = alloc_table();
+    if (!table) return NULL;
+    if (e & PTE_PRESENT) {
+        uint64_t flags = e & ~PTE_ADDR;
+        if (level - 1 == 1) flags &= ~PTE_LARGE;
+        uint64_t child = level_size(level - 1);
+        for (unsigned i = 0; i < 512; ++i) table[i] = ((e & PTE_ADDR) + i * child) | flags;
+        leaf_count[level]--;
+        leaf_count[level - 1] += 512;
+    }
+    *entry = (uint64_t)(uintptr_t)table | PTE_PRESENT | PTE_WRITE;
+    return table;
+}
+
+static int map_level(uint64_t *table, unsigned level, uint64_t start, uint64_t end, int forced) {
+    uint64_t size = level_size(level);
+    uint64_t addr = start;
+    while (addr < end) {
+        uint64_t span_end = (addr & ~(size - 1)) + size;
+        if (span_end > end) span_end = end;
+        uint64_t *entry = &table[level_index(addr, level)];
+        int leaf_ok = level == 1 || level == 2 || (level == 3 && has_1g);
+        if (leaf_ok && span_end - addr == size) {
+            int cache = forced >= 0 ? forced : classify(addr, size);
+            if (cache != CACHE_MIXED) {
+                uint64_t value = addr | PTE_PRESENT | PTE_WRITE | cache_bits(cache);
+                if (level > 1) value |= PTE_LARGE;
+                set_leaf(entry, level, value);
+                addr = span_end;
+                continue;
+            }
+        }
+        uint64_t *next = descend(entry, level);
+        if (!next) return -1;
+        if (map_level(next, level - 1, addr, span_end, forced) != 0) return -1;
+        addr = span_end;
+    }
+    return 0;
+}
+
+int paging_init(const struct aios_boot_info *boot) {
+    map_boot = boot;
+    has_1g = cpu_get_features()->pdpe1gb;
+    has_pat = cpu_get_features()->pat;
+
+    uint64_t top = MIN_MAPPED;
+    uint64_t entries = efi_descriptor_count(boot);
+    for (uint64_t i = 0; i < entries; ++i) {
+        uint64_t end = efi_descriptor_end(efi_descriptor(boot, i));
+        if (end > top) top = end;
+    }
+    top = (top + SIZE_1G - 1) & ~(SIZE_1G - 1);
+
+    const struct aios_framebuffer *fb = &boot->framebuffer;
+    if (fb->base) {
+        uint64_t bytes = (uint64_t)fb->pixels_per_scanline * fb->height * (fb->bpp ? fb->bpp / 8u : 4u);
+        fb_start = fb->base & ~(uint64_t)(PAGE_SIZE - 1);
+        fb_end = (fb->base + bytes + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+    }
+
+    pml4 = alloc_table();
+    if (!pml4) return -1;
+    if (map_level(pml4, 4, 0, top, -1) != 0) return -1;
+    mapped_bytes = top;
+
+    wbinvd();
+    if (has_pat) wrmsr(MSR_IA32_PAT, PAT_DEFAULT_WC);
+    write_cr3((uint64_t)(uintptr_t)pml4);
+    uint64_t cr4 = read_cr4();
+    if (cr4 & CR4_PGE) {
+        /* flush any global entries the firmware left behind */
+        write_cr4(cr4 & ~CR4_PGE);
+        write_cr4(cr4);
+    }
+    wbinvd();
+    return 0;
+}
+
+int paging_map(uint64_t base, uint64_t size, enum paging_cache cache) {
+    if (!pml4 || size == 0) return -1;
+    uint64_t start = base & ~(uint64_t)(PAGE_SIZE - 1);
+    uint64_t end = (base + size + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1);
+    int rc = map_level(pml4, 4, start, end, (int)cache);
+    write_cr3(read_cr3());
+    return rc;
+}
+
+void paging_get_stats(struct paging_stats *out) {
+    out->mapped_bytes = mapped_bytes;
+    out->pages_1g = leaf_count[3];
+    out->pages_2m = leaf_count[2];
+    out->pages_4k = leaf_count[1];
+    out->table_pages = table_pages;
+    out->has_1g = has_1g;
+    out->has_pat = has_pat;
+}
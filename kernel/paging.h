@@ -0,0 +1,30 @@
+#ifndef AIOS_KERNEL_PAGING_H
+#define AIOS_KERNEL_PAGING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "aios/bootinfo.h"
+
+enum paging_cache {
+    PAGING_WB = 0, /* RAM */
+    PAGING_WC = 1, /* framebuffer */
+    PAGING_UC = 2, /* MMIO */
+};
+
+struct paging_stats {
+    uint64_t mapped_bytes; /* identity map covers [0, mapped_bytes) */
+    uint32_t pages_1g;
+    uint32_t pages_2m;
+    uint32_t pages_4k;
+    uint32_t table_pages;
+    bool has_1g;
+    bool has_pat;
+};
+
+/* Build and load kernel-owned identity page tables. Needs cpu_init() and pmm_init(). */
+int paging_init(const struct aios_boot_info *boot);
+/* Remap [base, base + size) with the given cache type, splitting huge pages. */
+int paging_map(uint64_t base, uint64_t size, enum paging_cache cache);
+void paging_get_stats(struct paging_stats *out);
+
+#endif
@@ -0,0 +1,344 @@
+#include "pmm.h"
+#include "efi.h"
+#include "thread.h"
+#include "util.h"
+
+/*
+ * Buddy allocator over physical page frames.
+ *
+ * The loader hands us the final UEFI memory map. Conventional memory is free
+ * outright. Loader and boot-services ranges become reusable once the kernel
+ * no longer depends on them (the firmware's page tables live there, so this
+ * waits for paging_init), except for the pieces we still live in: the kernel
+ * image, the memory map itself, the RAM disk image, and the loader stack that
+ * holds both our stack frame and the boot info structure.
+ *
+ * Free blocks are linked through their own first bytes (memory is identity
+ * mapped). A one-byte state per frame records whether it heads a free or an
+ * allocated block and of which order, which is all the buddy merge needs.
+ *
+ * On top of that sits a pool of pre-zeroed single pages. It is topped up
+ * from idle time with non-temporal stores, so pmm_alloc_zeroed_pages(0)
+ * is usually a list pop that never touches the cache.
+ */
+
+#define LOW_MEMORY_LIMIT 0x100000ull /* leave real-mode era memory alone */
+#define MAX_RESERVED 8
+#define ZERO_POOL_TARGET 256 /* 1 MiB of ready zeroed pages */
+#define ZERO_POOL_MIN_FREE 1024 /* stop refilling when memory gets tight */
+
+#define FRAME_UNMANAGED 0x80u
+#define FRAME_FREE      0x40u
+#define FRAME_ALLOC     0x20u
+#define FRAME_ORDER     0x1Fu
+
+struct free_page {
+    struct free_page *next;
+    struct free_page *prev;
+};
+
+struct range {
+    uint64_t start;
+    uint64_t end;
+};
+
+static struct free_page *free_lists[PMM_MAX_ORDER + 1];
+static uint32_t free_counts[PMM_MAX_ORDER + 1];
+static uint8_t *frames = NULL;
+static uint64_t base_pfn = 0;
+static uint64_t end_pfn = 0;
+static uint64_t managed_pages = 0;
+static uint64_t free_pages = 0;
+static uint64_t reclaimed_pages = 0;
+static bool boot_memory_reclaimed = false;
+
+/* Pool pages stay marked allocated; the link word is cleared on pop. */
+static struct free_page *zero_pool = NULL;
+static uint32_t zero_pool_pages = 0;
+static uint64_t zero_pool_hits = 0;
+static uint64_t zero_pool_misses = 0;
+static pmm_zero_pool_hook_fn zero_pool_hook = NULL;
+
+static struct range reserved[MAX_RESERVED];
+static int reserved_count = 0;
+
+static uint64_t page_down(uint64_t v) { return v & ~(uint64_t)(PAGE_SIZE - 1); }
+static uint64_t page_up(uint64_t v) { return (v + PAGE_SIZE - 1) & ~(uint64_t)(PAGE_SIZE - 1); }
+
+static int reclaimable(uint32_t type) {
+    return type == EFI_CONVENTIONAL_MEMORY ||
+           type == EFI_LOADER_CODE || type == EFI_LOADER_DATA ||
+           type == EFI_BOOT_SERVICES_CODE || type == EFI_BOOT_SERVICES_DATA;
+}
+
+static void reserve(uint64_t start, uint64_t end) {
+    if (end <= start || reserved_count >= MAX_RESERVED) return;
+    reserved[reserved_count].start = page_down(start);
+    reserved[reserved_count].end = page_up(end);
+    reserved_count++;
+}
+
+/* Keep the whole descriptor that contains `addr`, e.g. the loader's stack. */
+static void reserve_containing(const struct aios_boot_info *boot, uint64_t addr) {
+    uint64_t entries = efi_descriptor_count(boot);
+    for (uint64_t i = 0; i < entries; ++i) {
+        const struct efi_memory_descriptor *d = efi_descriptor(boot, i);
+        uint64_t end = efi_descriptor_end(d);
+        if (addr >= d->physical_start && addr < end) {
+            reserve(d->physical_start, end);
+            return;
+        }
+    }
+}
+
+static uint8_t *frame_state(uint64_t pfn) { return &frames[pfn - base_pfn]; }
+
+static void list_push(unsigned order, uint64_t pfn) {
+    struct free_page *page = (struct free_page *)(uintptr_t)(pfn << PAGE_SHIFT);
+    page->prev = NULL;
+    page->next = free_lists[order];
+    if (page->next) page->next->prev = page;
+    free_lists[order] = page;
+    free_counts[order]++;
+    *frame_state(pfn) = (uint8_t)(FRAME_FREE | order);
+}
+
+static void list_remove(unsigned order, uint64_t pfn) {
+    struct free_page *page = (struct free_page *)(uintptr_t)(pfn << PAGE_SHIFT);
+    if (page->prev) page->prev->next = page->next;
+    else free_lists[order] = page->next;
+    if (page->next) page->next->prev = page->prev;
+    free_counts[order]--;
+    *frame_state(pfn) = 0;
+}
+
+static void buddy_free(uint64_t pfn, unsigned order) {
+    free_pages += 1ull << order;
+    while (order < PMM_MAX_ORDER) {
+        uint64_t buddy = pfn ^ (1ull << order);
+        if (buddy < base_pfn || buddy + (1ull << order) > end_pfn) break;
+        if (*frame_state(buddy) != (FRAME_FREE | order)) break;
+        list_remove(order, buddy);
+        *frame_state(pfn) = 0;
+        if (buddy < pfn) pfn = buddy;
+        order++;
+    }
+    list_push(order, pfn);
+}
+
+/* Hand [start, end) to the allocator in the largest naturally aligned blocks. */
+static void free_range(uint64_t start, uint64_t end) {
+    uint64_t pfn = page_up(start) >> PAGE_SHIFT;
+    uint64_t last = page_down(end) >> PAGE_SHIFT;
+    while (pfn < last) {
+        unsigned order = 0;
+        while (order < PMM_MAX_ORDER &&
+               (pfn & ((1ull << (order + 1)) - 1)) == 0 &&
+               pfn + (1ull << (order + 1)) <= last) {
+            order++;
+        }
+        managed_pages += 1ull << order;
+        buddy_free(pfn, order);
+        pfn += 1ull << order;
+    }
+}
+
+static void seed_range(uint64_t start, uint64_t end, int reclaim) {
+    if (start < LOW_MEMORY_LIMIT) start = LOW_MEMORY_LIMIT;
+    if (end <= start) return;
+    for (int i = 0; i < reserved_count; ++i) {
+        if (reserved[i].start < end && reserved[i].end > start) {
+            seed_range(start, reserved[i].start, reclaim);
+            seed_range(reserved[i].end, end, reclaim);
+            return;
+        }
+    }
+    uint64_t before = managed_pages;
+    free_range(start, end);
+    if (reclaim) reclaimed_pages += managed_pages - before;
+}
+
+/* Carve the frame-state array out of the top of some conventional range. */
+static int place_frame_array(const struct aios_boot_info *boot, uint64_t bytes) {
+    uint64_t entries = efi_descriptor_count(boot);
+    uint64_t need = page_up(bytes);
+    for (uint64_t i = 0; i < entries; ++i) {
+        const struct efi_memory_descriptor *d = efi_descriptor(boot, i);
+        if (d->type != EFI_CONVENTIONAL_MEMORY) continue;
+        uint64_t start = d->physical_start;
+        uint64_t end = start + d->number_of_pages * PAGE_SIZE;
+        if (start < LOW_MEMORY_LIMIT) start = LOW_MEMORY_LIMIT;
+        if (end <= start || end - start < need) continue;
+        uint64_t base = page_down(end - need);
+        frames = (uint8_t *)(uintptr_t)base;
+        reserve(base, base + need);
+        return 0;
+    }
+    return -1;
+}
+
+int pmm_init(const struct aios_boot_info *boot) {
+    uint64_t entries = efi_descriptor_count(boot);
+    if (entries == 0) return -1;
+
+    uint64_t lowest = ~0ull;
+    uint64_t highest = 0;
+    for (uint64_t i = 0; i < entries; ++i) {
+        const struct efi_memory_descriptor *d = efi_descriptor(boot, i);
+        if (!reclaimable(d->type)) continue;
+        uint64_t start = d->physical_start < LOW_MEMORY_LIMIT ? LOW_MEMORY_LIMIT : d->physical_start;
+        uint64_t end = efi_descriptor_end(d);
+        if (end <= start) continue;
+        if (start < lowest) lowest = start;
+        if (end > highest) highest = end;
+    }
+    if (highest == 0) return -1;
+    base_pfn = page_down(lowest) >> PAGE_SHIFT;
+    end_pfn = page_up(highest) >> PAGE_SHIFT;
+
+    reserved_count = 0;
+    reserve(boot->kernel_base, boot->kernel_base + boot->kernel_size);
+    reserve(boot->memory_map.buffer, boot->memory_map.buffer + boot->memory_map.size);
+    if (boot->fs_image_base && boot->fs_image_size) {
+        reserve(boot->fs_image_base, boot->fs_image_base + boot->fs_image_size);
+    }
+    reserve_containing(boot, (uint64_t)(uintptr_t)boot);
+    reserve_containing(boot, (uint64_t)(uintptr_t)__builtin_frame_address(0));
+
+    if (place_frame_array(boot, end_pfn - base_pfn) != 0) return -1;
+    memset(frames, FRAME_UNMANAGED, end_pfn - base_pfn);
+
+    for (unsigned o = 0; o <= PMM_MAX_ORDER; ++o) {
+        free_lists[o] = NULL;
+        free_counts[o] = 0;
+    }
+    managed_pages = free_pages = reclaimed_pages = 0;
+    boot_memory_reclaimed = false;
+    zero_pool = NULL;
+    zero_pool_pages = 0;
+    zero_pool_hits = zero_pool_misses = 0;
+
+    for (uint64_t i = 0; i < entries; ++i) {
+        const struct efi_memory_descriptor *d = efi_descriptor(boot, i);
+        if (d->type != EFI_CONVENTIONAL_MEMORY) continue;
+        seed_range(d->physical_start, efi_descriptor_end(d), 0);
+    }
+    return managed_pages ? 0 : -1;
+}
+
+void pmm_reclaim_boot_memory(const struct aios_boot_info *boot) {
+    if (boot_memory_reclaimed) return;
+    boot_memory_reclaimed = true;
+    uint64_t entries = efi_descriptor_count(boot);
+    for (uint64_t i = 0; i < entries; ++i) {
+        const struct efi_memory_descriptor *d = efi_descriptor(boot, i);
+        if (d->type == EFI_CONVENTIONAL_MEMORY || !reclaimable(d->type)) continue;
+        seed_range(d->physical_start, efi_descriptor_end(d), 1);
+    }
+}
+
+static void *zero_pool_pop(void) {
+    struct free_page *page = zero_pool;
+    if (!page) return NULL;
+    zero_pool = page->next;
+    zero_pool_pages--;
+    page->next = NULL;
+    return page;
+}
+
+static void *alloc_pages(unsigned order) {
+    unsigned o = order;
+    while (o <= PMM_MAX_ORDER && !free_lists[o]) o++;
+    if (o > PMM_MAX_ORDER) return order == 0 ? zero_pool_pop() : NULL;
+
+    uint64_t pfn = (uint64_t)(uintptr_t)free_lists[o] >> PAGE_SHIFT;
+    list_remove(o, pfn);
+    while (o > order) {
+        o--;
+        list_push(o, pfn + (1ull << o));
+    }
+    *frame_state(pfn) = (uint8_t)(FRAME_ALLOC | order);
+    free_pages -= 1ull << order;
+    return (void *)(uintptr_t)(pfn << PAGE_SHIFT);
+}
+
+/* Threads share the allocator, so it runs with preemption off. */
+void *pmm_alloc_pages(unsigned order) {
+    if (order > PMM_MAX_ORDER) return NULL;
+    preempt_disable();
+    void *mem = alloc_pages(order);
+    preempt_enable();
+    return mem;
+}
+
+void pmm_free_pages(void *addr, unsigned order) {
+    if (!addr || order > PMM_MAX_ORDER) return;
+    uint64_t pfn = (uint64_t)(uintptr_t)addr >> PAGE_SHIFT;
+    if (pfn < base_pfn || pfn >= end_pfn) return;
+    preempt_disable();
+    if (*frame_state(pfn) == (FRAME_ALLOC | order)) buddy_free(pfn, order); /* else not ours, or wrong order */
+    preempt_enable();
+}
+
+void *pmm_alloc_zeroed_pages(unsigned order) {
+    if (zero_pool_hook && zero_pool_pages <= ZERO_POOL_TARGET / 2) zero_pool_hook();
+    if (order == 0) {
+        preempt_disable();
+        void *page = zero_pool_pop();
+        if (page) zero_pool_hits++;
+        else zero_pool_misses++;
+        preempt_enable();
+        if (page) return page;
+    }
+    void *mem = pmm_alloc_pages(order);
+    if (mem) memzero_nt(mem, (size_t)PAGE_SIZE << order);
+    return mem;
+}
+
+bool pmm_zero_pool_needs_refill(void) {
+    return zero_pool_pages < ZERO_POOL_TARGET && free_pages > ZERO_POOL_MIN_FREE;
+}
+
+uint32_t pmm_zero_pool_refill(uint32_t max_pages) {
+    uint32_t added = 0;
+    while (added < max_pages && pmm_zero_pool_needs_refill()) {
+        struct free_page *page = (struct free_page *)pmm_alloc_pages(0);
+        if (!page) break;
+        memzero_nt(page, PAGE_SIZE);
+        preempt_disable();
+        page->next = zero_pool;
+        zero_pool = page;
+        zero_pool_pages++;
+        preempt_enable();
+        added++;
+    }
+    return added;
+}
+
+void pmm_set_zero_pool_hook(pmm_zero_pool_hook_fn fn) {
+    zero_pool_hook = fn;
+}
+
+unsigned pmm_order_for(size_t bytes) {
+    unsigned order = 0;
+    while (order < PMM_MAX_ORDER && ((size_t)PAGE_SIZE << order) < bytes) order++;
+    return order;
+}
+
+void pmm_get_stats(struct pmm_stats *out) {
+    out->managed_pages = managed_pages;
+    out->free_pages = free_pages;
+    out->reclaimed_pages = reclaimed_pages;
+    out->highest_address = end_pfn << PAGE_SHIFT;
+    out->zero_pool_pages = zero_pool_pages;
+    out->zero_pool_hits = zero_pool_hits;
+    out->zero_pool_misses = zero_pool_misses;
+    for (unsigned o = 0; o <= PMM_MAX_ORDER; ++o) out->free_blocks[o] = free_counts[o];
+}
+
+void pmm_reset_stats(void) {
+    preempt_disable();
+    zero_pool_hits = 0;
+    zero_pool_misses = 0;
+    preempt_enable();
+}
@@ -0,0 +1,41 @@
+#ifndef AIOS_KERNEL_PMM_H
+#define AIOS_KERNEL_PMM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "aios/bootinfo.h"
+
+#define PAGE_SIZE 4096u
+#define PAGE_SHIFT 12
+#define PMM_MAX_ORDER 15 /* largest block: 2^15 pages = 128 MiB */
+
+struct pmm_stats {
+    uint64_t managed_pages;   /* pages handed to the buddy allocator */
+    uint64_t free_pages;
+    uint64_t reclaimed_pages; /* loader/boot-services pages returned after handoff */
+    uint64_t highest_address;
+    uint32_t zero_pool_pages;   /* pre-zeroed pages ready to hand out */
+    uint64_t zero_pool_hits;
+    uint64_t zero_pool_misses;  /* order-0 requests the pool could not serve */
+    uint32_t free_blocks[PMM_MAX_ORDER + 1];
+};
+
+int pmm_init(const struct aios_boot_info *boot);
+/* Free loader/boot-services memory; only safe once off the firmware page tables. */
+void pmm_reclaim_boot_memory(const struct aios_boot_info *boot);
+void *pmm_alloc_pages(unsigned order);
+void pmm_free_pages(void *addr, unsigned order);
+void *pmm_alloc_zeroed_pages(unsigned order);
+/* Zero up to max_pages more pages into the pool; call when idle. */
+uint32_t pmm_zero_pool_refill(uint32_t max_pages);
+/* True while the pool is below target and free memory allows a refill. */
+bool pmm_zero_pool_needs_refill(void);
+/* Called when the pool drops below half its target, to kick a refiller. */
+typedef void (*pmm_zero_pool_hook_fn)(void);
+void pmm_set_zero_pool_hook(pmm_zero_pool_hook_fn fn);
+unsigned pmm_order_for(size_t bytes);
+void pmm_get_stats(struct pmm_stats *out);
+void pmm_reset_stats(void); /* zero pool hit/miss counters */
+
+#endif
@@ -0,0 +1,196 @@
+#include "profile.h"
+#include "idt.h"
+#include "ksyms.h"
+#include "lapic.h"
+#include "mem.h"
+#include "pmm.h"
+#include "serial.h"
+#include "thread.h"
+#include "util.h"
+
+#define PROFILE_MAX_SAMPLES 16384u
+#define PROFILE_MAX_DEPTH 16
+#define PROFILE_STACK_WINDOW (64u * 1024u) /* frames further up than this end the walk */
+#define PROFILE_UNKNOWN UINT64_MAX
+
+struct profile_sample {
+    uint64_t pc[PROFILE_MAX_DEPTH]; /* [0] = interrupted RIP, then return addresses */
+    uint32_t depth;
+    uint32_t symbolized;            /* pc[] now holds ksym indices */
+};
+
+static struct profile_sample *samples = 0;
+static unsigned samples_order = 0;
+static volatile uint32_t sample_count = 0;
+static volatile uint32_t dropped = 0;
+static volatile bool running = false;
+
+static void on_tick(struct interrupt_frame *frame) {
+    if (sample_count < PROFILE_MAX_SAMPLES) {
+        struct profile_sample *s = &samples[sample_count];
+        uint32_t depth = 0;
+        s->pc[depth++] = frame->rip;
+        uint64_t fp = frame->rbp;
+        uint64_t floor = frame->rsp;
+        while (depth < PROFILE_MAX_DEPTH && fp >= floor && fp - floor < PROFILE_STACK_WINDOW && !(fp & 7u)) {
+            const uint64_t *f = (const uint64_t *)(uintptr_t)fp;
+            if (f[1] == 0) break;
+            s->pc[depth++] = f[1];
+            floor = fp + 16;
+            fp = f[0];
+        }
+        s->depth = depth;
+        s->symbolized = 0;
+        sample_count++;
+    } else {
+        dropped++;
+    }
+    thread_tick(false);
+    lapic_eoi();
+}
+
+bool profile_available(void) {
+    return lapic_present() && lapic_timer_hz() != 0;
+}
+
+int profile_start(uint32_t hz) {
+    if (!profile_available() || running) return -1;
+    if (!samples) {
+        samples_order = pmm_order_for(PROFILE_MAX_SAMPLES * sizeof(struct profile_sample));
+        samples = (struct profile_sample *)pmm_alloc_pages(samples_order);
+        if (!samples) return -1;
+    }
+    sample_count = 0;
+    dropped = 0;
+    idt_set_handler(IRQ_VECTOR_TIMER, on_tick);
+    running = true;
+    return lapic_timer_start(hz, IRQ_VECTOR_TIMER);
+}
+
+void profile_stop(void) {
+    if (!running) return;
+    lapic_timer_stop();
+    running = false;
+    thread_timer_resume();
+}
+
+static void symbolize(struct profile_sample *s) {
+    if (s->symbolized) return;
+    for (uint32_t i = 0; i < s->depth; ++i) {
+        /* return addresses point past the call; look up the call itself */
+        int idx = ksym_index(i ? s->pc[i] - 1 : s->pc[i]);
+        s->pc[i] = idx < 0 ? PROFILE_UNKNOWN : (uint64_t)idx;
+    }
+    s->symbolized = 1;
+}
+
+static const char *sym_name(uint64_t idx) {
+    return idx == PROFILE_UNKNOWN ? "[unknown]" : ksym_table[idx].name;
+}
+
+static void write_pct(uint32_t part, uint32_t whole) {
+    uint32_t tenths = whole ? (uint32_t)((uint64_t)part * 1000u / whole) : 0;
+    if (tenths < 1000) serial_write(" ");
+    if (tenths < 100) serial_write(" ");
+    serial_write_u32(tenths / 10u);
+    serial_write(".");
+    serial_write_u32(tenths % 10u);
+    serial_write("%");
+}
+
+void profile_report(uint32_t top) {
+    uint32_t n = sample_count;
+    serial_write("profile: ");
+    serial_write_u32(n);
+    serial_write(" samples");
+    if (dropped) {
+        serial_write(", ");
+        serial_write_u32(dropped);
+        serial_write(" dropped");
+    }
+    serial_write("\r\n");
+    if (n == 0) return;
+    if (ksym_count == 0) serial_write("profile: no symbol table in this kernel (build with scripts/setup_env.sh)\r\n");
+
+    /* self counts; the extra slot is for unknown addresses */
+    uint32_t *self = (uint32_t *)kcalloc(ksym_count + 1u, sizeof(uint32_t));
+    if (!self) {
+        serial_write("profile: out of memory\r\n");
+        return;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        symbolize(&samples[i]);
+        uint64_t leaf = samples[i].pc[0];
+        self[leaf == PROFILE_UNKNOWN ? ksym_count : leaf]++;
+    }
+    serial_write("   self  samples  function\r\n");
+    for (uint32_t rank = 0; rank < top; ++rank) {
+        uint32_t best = 0;
+        for (uint32_t k = 1; k <= ksym_count; ++k) {
+            if (self[k] > self[best]) best = k;
+        }
+        if (self[best] == 0) break;
+        serial_write("  ");
+        write_pct(self[best], n);
+        serial_write("  ");
+        serial_write_u32(self[best]);
+        serial_write("  ");
+        serial_write(best == ksym_count ? "[unknown]" : ksym_table[best].name);
+        serial_write("\r\n");
+        self[best] = 0;
+    }
+    kfree(self);
+}
+
+/* Orders stacks outermost frame first so identical stacks end up adjacent. */
+static int stack_cmp(const struct profile_sample *a, const struct profile_sample *b) {
+    uint32_t i = a->depth, j = b->depth;
+    while (i > 0 && j > 0) {
+        uint64_t x = a->pc[--i], y = b->pc[--j];
+        if (x != y) return x < y ? -1 : 1;
+    }
+    if (i == j) return 0;
+    return i < j ? -1 : 1;
+}
+
+void profile_report_folded(void) {
+    uint32_t n = sample_count;
+    uint32_t *order = (uint32_t *)kalloc((n ? n : 1) * sizeof(uint32_t));
+    if (!order) {
+        serial_write("profile: out of memory\r\n");
+        return;
+    }
+    for (uint32_t i = 0; i < n; ++i) {
+        symbolize(&samples[i]);
+        order[i] = i;
+    }
+    /* shell sort: n is small and this runs once per report */
+    for (uint32_t gap = n / 2; gap > 0; gap /= 2) {
+        for (uint32_t i = gap; i < n; ++i) {
+            uint32_t v = order[i];
+            uint32_t j = i;
+            while (j >= gap && stack_cmp(&samples[order[j - gap]], &samples[v]) > 0) {
+                order[j] = order[j - gap];
+                j -= gap;
+            }
+            order[j] = v;
+        }
+    }
+
+    serial_write("#folded\r\n");
+    for (uint32_t i = 0; i < n;) {
+        const struct profile_sample *s = &samples[order[i]];
+        uint32_t run = 1;
+        while (i + run < n && stack_cmp(s, &samples[order[i + run]]) == 0) run++;
+        for (uint32_t d = s->depth; d > 0; --d) {
+            serial_write(sym_name(s->pc[d - 1]));
+            if (d > 1) serial_write(";");
+        }
+        serial_write(" ");
+        serial_write_u32(run);
+        serial_write("\r\n");
+        i += run;
+    }
+    serial_write("#end\r\n");
+    kfree(order);
+}
@@ -0,0 +1,22 @@
+#ifndef AIOS_KERNEL_PROFILE_H
+#define AIOS_KERNEL_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PROFILE_DEFAULT_HZ 997 /* not a round number, so it does not beat with periodic work */
+
+/*
+ * Sampling profiler. The LAPIC timer interrupts at `hz`; each tick records
+ * the interrupted RIP plus a frame-pointer backtrace into a buffer that
+ * is kept until the next profile_start(). Reports are symbolized with the
+ * table from ksyms.h. The scheduler tick keeps running off the profiler's
+ * timer and gets its own rate back at profile_stop().
+ */
+int profile_start(uint32_t hz);
+void profile_stop(void);
+bool profile_available(void); /* LAPIC timer usable */
+void profile_report(uint32_t top);  /* hottest functions by self samples */
+void profile_report_folded(void);   /* "outer;...;leaf count" lines for flame graphs */
+
+#endif
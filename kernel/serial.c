@@ -1,6 +1,32 @@
 #include "kernel/serial.h"
+#include "kernel/cpu.h"
+#include "kernel/idle.h"
+#include "kernel/irq.h"
+#include "kernel/thread.h"
 
 #define COM1_PORT 0x3F8
+#define COM1_IRQ  4
+
+#define UART_DATA 0
+#define UART_IER  1
+#define UART_IIR  2
+#define UART_LSR  5
+#define UART_MSR  6
+
+#define IER_RX_AVAILABLE 0x01
+#define IER_TX_EMPTY     0x02
+#define IIR_NONE         0x01
+#define IIR_ID_MASK      0x0E
+#define IIR_LINE_STATUS  0x06
+#define IIR_RX_AVAILABLE 0x04
+#define IIR_RX_TIMEOUT   0x0C
+#define IIR_TX_EMPTY     0x02
+#define LSR_DATA_READY   0x01
+#define LSR_THR_EMPTY    0x20
+
+#define UART_FIFO_DEPTH 16
+#define TX_RING_SIZE 8192u /* powers of two */
+#define RX_RING_SIZE 256u
 
 static inline void outb(uint16_t port, uint8_t value) {
     __asm__ __volatile__("outb %0, %1" : : "a"(value), "Nd"(port));
@@ -12,14 +38,113 @@ static inline uint8_t inb(uint16_t port) {
     return value;
 }
 
+/* Indices only grow; the writer owns head, the reader tail. */
+static uint8_t tx_ring[TX_RING_SIZE];
+static uint32_t tx_head = 0, tx_tail = 0;
+static uint8_t rx_ring[RX_RING_SIZE];
+static volatile uint32_t rx_head = 0, rx_tail = 0;
+static uint8_t ier = 0;
+static bool irq_mode = false;
+static struct serial_stats stats;
+static struct wait_queue rx_wait;
+
 static void serial_wait(void) {
-    while ((inb(COM1_PORT + 5) & 0x20) == 0) {
+    while ((inb(COM1_PORT + UART_LSR) & LSR_THR_EMPTY) == 0) {
         __asm__ __volatile__("pause");
     }
 }
 
 static int serial_ready(void) {
-    return inb(COM1_PORT + 5) & 0x01;
+    return inb(COM1_PORT + UART_LSR) & LSR_DATA_READY;
+}
+
+static void set_ier(uint8_t value) {
+    ier = value;
+    outb(COM1_PORT + UART_IER, value);
+}
+
+/*
+ * One FIFO's worth from the TX ring if the FIFO is empty; the caller has
+ * interrupts off. Whatever is left keeps the THRE interrupt armed, even
+ * while the FIFO is still busy, so queued bytes cannot be stranded.
+ */
+static void tx_fill(void) {
+    if (inb(COM1_PORT + UART_LSR) & LSR_THR_EMPTY) {
+        for (int i = 0; i < UART_FIFO_DEPTH && tx_tail != tx_head; ++i) {
+            outb(COM1_PORT + UART_DATA, tx_ring[tx_tail++ & (TX_RING_SIZE - 1)]);
+        }
+    }
+    if (tx_tail == tx_head) {
+        if (ier & IER_TX_EMPTY) set_ier(ier & ~IER_TX_EMPTY);
+    } else if (!(ier & IER_TX_EMPTY)) {
+        set_ier(ier | IER_TX_EMPTY);
+    }
+}
+
+static void rx_drain(void) {
+    uint32_t head = rx_head;
+    while (serial_ready()) {
+        uint8_t c = inb(COM1_PORT + UART_DATA);
+        if (rx_head - rx_tail == RX_RING_SIZE) {
+            stats.rx_dropped++;
+            continue;
+        }
+        rx_ring[rx_head & (RX_RING_SIZE - 1)] = c;
+        rx_head++;
+        stats.rx_bytes++;
+    }
+    if (rx_head != head) wait_queue_wake_all(&rx_wait);
+}
+
+static void serial_irq(struct interrupt_frame *frame) {
+    (void)frame;
+    for (;;) {
+        uint8_t iir = inb(COM1_PORT + UART_IIR);
+        if (iir & IIR_NONE) break;
+        switch (iir & IIR_ID_MASK) {
+        case IIR_RX_AVAILABLE:
+        case IIR_RX_TIMEOUT:
+            rx_drain();
+            break;
+        case IIR_TX_EMPTY:
+            tx_fill();
+            break;
+        case IIR_LINE_STATUS:
+            inb(COM1_PORT + UART_LSR);
+            break;
+        default:
+            inb(COM1_PORT + UART_MSR);
+            break;
+        }
+    }
+}
+
+/* Interrupts are off in irq mode. */
+static void put_byte(uint8_t c) {
+    stats.tx_bytes++;
+    if (!irq_mode) {
+        serial_wait();
+        outb(COM1_PORT + UART_DATA, c);
+        return;
+    }
+    while (tx_head - tx_tail == TX_RING_SIZE) {
+        stats.tx_stalls++;
+        serial_wait();
+        tx_fill();
+    }
+    tx_ring[tx_head++ & (TX_RING_SIZE - 1)] = c;
+}
+
+static void write_bytes(const char *str) {
+    uint64_t flags = irq_mode ? irq_save() : 0;
+    while (*str) {
+        if (*str == '\n') put_byte('\r');
+        put_byte((uint8_t)*str++);
+    }
+    if (irq_mode) {
+        tx_fill();
+        irq_restore(flags);
+    }
 }
 
 void serial_init(void) {
@@ -28,49 +153,103 @@ void serial_init(void) {
     outb(COM1_PORT + 0, 0x03);
     outb(COM1_PORT + 1, 0x00);
     outb(COM1_PORT + 3, 0x03);
-    outb(COM1_PORT + 2, 0xC7);
-    outb(COM1_PORT + 4, 0x0B);
+    outb(COM1_PORT + 2, 0xC7); /* FIFOs on and cleared, RX trigger at 14 bytes */
+    outb(COM1_PORT + 4, 0x0B); /* DTR, RTS, OUT2 (IRQ line enable) */
 }
 
-void serial_write(const char *str) {
-    while (*str) {
-        if (*str == '\n') {
-            serial_wait();
-            outb(COM1_PORT, '\r');
-        }
+int serial_enable_irq(void) {
+    if (irq_mode) return 0;
+    if (irq_register_isa(COM1_IRQ, "com1", serial_irq) < 0) return -1;
+    uint64_t flags = irq_save();
+    irq_mode = true;
+    stats.irq_mode = true;
+    rx_drain();
+    set_ier(IER_RX_AVAILABLE);
+    irq_restore(flags);
+    return 0;
+}
+
+void serial_emergency(void) {
+    irq_disable();
+    if (!irq_mode) return;
+    irq_mode = false;
+    stats.irq_mode = false;
+    set_ier(0);
+    while (tx_tail != tx_head) {
         serial_wait();
-        outb(COM1_PORT, (uint8_t)*str++);
+        outb(COM1_PORT + UART_DATA, tx_ring[tx_tail++ & (TX_RING_SIZE - 1)]);
     }
 }
 
-int serial_getc(void) {
-    while (!serial_ready()) {
+void serial_write(const char *str) {
+    write_bytes(str);
+}
+
+int serial_try_getc(void) {
+    if (!irq_mode) {
+        if (!serial_ready()) return -1;
+        stats.rx_bytes++;
+        return inb(COM1_PORT + UART_DATA);
+    }
+    if (rx_tail == rx_head) return -1;
+    int c = rx_ring[rx_tail & (RX_RING_SIZE - 1)];
+    rx_tail++;
+    return c;
+}
+
+void serial_idle(void) {
+    if (!irq_mode || !irq_enabled()) {
         __asm__ __volatile__("pause");
+        return;
     }
-    return inb(COM1_PORT);
+    irq_disable();
+    if (rx_tail != rx_head) irq_enable();
+    else if (thread_running()) wait_queue_wait(&rx_wait);
+    else cpu_idle();
+}
+
+int serial_getc(void) {
+    int c;
+    while ((c = serial_try_getc()) < 0) {
+        serial_idle();
+    }
+    return c;
+}
+
+void serial_get_stats(struct serial_stats *out) {
+    *out = stats;
+}
+
+void serial_reset_stats(void) {
+    stats.tx_bytes = 0;
+    stats.rx_bytes = 0;
+    stats.rx_dropped = 0;
+    stats.tx_stalls = 0;
 }
 
 static const char HEX_TABLE[] = "0123456789ABCDEF";
 
 void serial_write_hex(uint64_t value) {
-    serial_write("0x");
-    for (int i = 60; i >= 0; i -= 4) {
-        char c = HEX_TABLE[(value >> i) & 0xF];
-        serial_wait();
-        outb(COM1_PORT, c);
+    char buffer[19];
+    buffer[0] = '0';
+    buffer[1] = 'x';
+    for (int i = 0; i < 16; ++i) {
+        buffer[2 + i] = HEX_TABLE[(value >> (60 - 4 * i)) & 0xF];
     }
+    buffer[18] = '\0';
+    serial_write(buffer);
 }
 
-void serial_write_u32(uint32_t value) {
-    char buffer[16];
+void serial_write_u64(uint64_t value) {
+    char buffer[24];
     int idx = 0;
     if (value == 0) {
         buffer[idx++] = '0';
     } else {
-        uint32_t temp = value;
-        char reversed[16];
+        uint64_t temp = value;
+        char reversed[24];
         int r = 0;
-        while (temp > 0 && r < 15) {
+        while (temp > 0 && r < 23) {
             reversed[r++] = '0' + (temp % 10);
             temp /= 10;
         }
@@ -81,3 +260,7 @@ void serial_write_u32(uint32_t value) {
     buffer[idx] = '\0';
     serial_write(buffer);
 }
+
+void serial_write_u32(uint32_t value) {
+    serial_write_u64(value);
+}
@@ -1,12 +1,39 @@
 #ifndef AIOS_KERNEL_SERIAL_H
 #define AIOS_KERNEL_SERIAL_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+struct serial_stats {
+    bool irq_mode;
+    uint64_t tx_bytes;
+    uint64_t rx_bytes;
+    uint64_t rx_dropped;  /* RX ring full */
+    uint64_t tx_stalls;   /* TX ring full; drained by polling */
+};
+
+/*
+ * COM1 16550. Output and input are polled until serial_enable_irq()
+ * (needs irq.h), after which writes go into a TX ring drained by the THRE
+ * interrupt one FIFO (16 bytes) at a time and received bytes are buffered
+ * by the RX interrupt. serial_emergency() drops back to polled output and
+ * flushes the ring; it is safe from exception handlers.
+ */
 void serial_init(void);
+int serial_enable_irq(void);
+void serial_emergency(void);
 void serial_write(const char *str);
 void serial_write_hex(uint64_t value);
 void serial_write_u32(uint32_t value);
+void serial_write_u64(uint64_t value);
 int serial_getc(void);
+int serial_try_getc(void); /* -1 if nothing is pending */
+/*
+ * Wait a little for input. When RX is interrupt-driven this blocks until a
+ * byte arrives (other threads run meanwhile) or halts until the next interrupt.
+ */
+void serial_idle(void);
+void serial_get_stats(struct serial_stats *out);
+void serial_reset_stats(void);
 
 #endif
@@ -2,6 +2,23 @@
 #include "serial.h"
 #include "util.h"
 #include "mem.h"
+#include "pmm.h"
+#include "paging.h"
+#include "slab.h"
+#include "crc32c.h"
+#include "hist.h"
+#include "boottime.h"
+#include "bench.h"
+#include "profile.h"
+#include "time.h"
+#include "trace.h"
+#include "fsrec.h"
+#include "acpi.h"
+#include "ioapic.h"
+#include "irq.h"
+#include "lapic.h"
+#include "idle.h"
+#include "thread.h"
 #include "fs/fs.h"
 #include "aios/bootinfo.h"
 
@@ -11,10 +28,19 @@
 
 static void print(const char *s) { serial_write(s); }
 
+/* Wait for input; without threads, top up the zeroed-page pool before halting. */
+static int idle_getc(void) {
+    for (;;) {
+        int c = serial_try_getc();
+        if (c >= 0) return c;
+        if (thread_running() || pmm_zero_pool_refill(1) == 0) serial_idle();
+    }
+}
+
 static int read_line(char *out, size_t max) {
     size_t len = 0;
     while (len + 1 < max) {
-        int c = serial_getc();
+        int c = idle_getc();
         if (c == '\r' || c == '\n') {
             print("\r\n");
             break;
@@ -119,16 +145,239 @@ static int ensure_fs_ready(struct storage_state *storage) {
 
 static void sysinfo_ram(const struct aios_boot_info *boot) {
     uint64_t total = boot->memory_summary.total_usable_bytes;
-    uint64_t heap_total = mem_total();
-    uint64_t heap_used = mem_used();
+    struct mem_stats heap;
+    mem_get_stats(&heap);
     print("Physical RAM: 0x");
     serial_write_hex(total);
     print(" bytes\r\n");
     print("Kernel heap: used ");
-    serial_write_hex(heap_used);
+    serial_write_hex(heap.used_bytes);
     print(" / total ");
-    serial_write_hex(heap_total);
+    serial_write_hex(heap.total_bytes);
     print(" bytes\r\n");
+    print("  Free: ");
+    serial_write_hex(heap.free_bytes);
+    print(" bytes in ");
+    serial_write_u32((uint32_t)heap.free_blocks);
+    print(" blocks (largest ");
+    serial_write_hex(heap.largest_free);
+    print(")\r\n  Live blocks: ");
+    serial_write_u32((uint32_t)heap.used_blocks);
+    print("  fragmentation: ");
+    serial_write_u32(mem_fragmentation_pct(&heap));
+    print("%\r\n");
+
+    struct pmm_stats pages;
+    pmm_get_stats(&pages);
+    print("Page allocator: free 0x");
+    serial_write_hex(pages.free_pages);
+    print(" / managed 0x");
+    serial_write_hex(pages.managed_pages);
+    print(" pages (reclaimed 0x");
+    serial_write_hex(pages.reclaimed_pages);
+    print(")\r\n  Free blocks by order:");
+    for (unsigned o = 0; o <= PMM_MAX_ORDER; ++o) {
+        print(" ");
+        serial_write_u32(pages.free_blocks[o]);
+    }
+    print("\r\n  Zeroed pool: ");
+    serial_write_u32(pages.zero_pool_pages);
+    print(" pages (hits ");
+    serial_write_hex(pages.zero_pool_hits);
+    print(", misses ");
+    serial_write_hex(pages.zero_pool_misses);
+    print(")\r\n");
+
+    struct paging_stats vm;
+    paging_get_stats(&vm);
+    print("Paging: identity map to 0x");
+    serial_write_hex(vm.mapped_bytes);
+    print(" with 1G ");
+    serial_write_u32(vm.pages_1g);
+    print(" / 2M ");
+    serial_write_u32(vm.pages_2m);
+    print(" / 4K ");
+    serial_write_u32(vm.pages_4k);
+    print(" pages, ");
+    serial_write_u32(vm.table_pages);
+    print(" table pages");
+    if (!vm.has_1g) print(" (no 1G pages)");
+    if (!vm.has_pat) print(" (no PAT)");
+    print("\r\n");
+}
+
+#define HEAP_TOP_SITES 8
+
+static void sysinfo_heap(int argc, char **argv) {
+    if (argc > 2) {
+        if (strcmp(argv[2], "on") == 0) {
+            mem_track_enable(1);
+        } else if (strcmp(argv[2], "off") == 0) {
+            mem_track_enable(0);
+        } else if (strcmp(argv[2], "reset") == 0) {
+            mem_track_reset();
+        } else {
+            print("usage: sysinfo heap [on|off|reset]\r\n");
+            return;
+        }
+    }
+    print("Heap tracking: ");
+    print(mem_track_enabled() ? "on\r\n" : "off (enable with \"sysinfo heap on\")\r\n");
+
+    uint32_t count = 0;
+    const struct mem_track_site *sites = mem_track_sites(&count);
+    bool shown[MEM_TRACK_SITES] = {false};
+    print("call site             live bytes  live  peak bytes  allocs  frees\r\n");
+    for (int rank = 0; rank < HEAP_TOP_SITES; ++rank) {
+        int best = -1;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (shown[i]) continue;
+            if (best < 0 || sites[i].live_bytes > sites[best].live_bytes ||
+                (sites[i].live_bytes == sites[best].live_bytes && sites[i].allocs > sites[best].allocs)) {
+                best = (int)i;
+            }
+        }
+        if (best < 0) break;
+        shown[best] = true;
+        const struct mem_track_site *site = &sites[best];
+        if (site->caller) serial_write_hex(site->caller);
+        else print("(other sites)     ");
+        print("  ");
+        serial_write_u32((uint32_t)site->live_bytes);
+        print("  ");
+        serial_write_u32(site->live_count);
+        print("  ");
+        serial_write_u32((uint32_t)site->peak_bytes);
+        print("  ");
+        serial_write_u32((uint32_t)site->allocs);
+        print("  ");
+        serial_write_u32((uint32_t)site->frees);
+        print("\r\n");
+    }
+
+    const uint64_t *hist = mem_track_histogram();
+    print("Request sizes:\r\n");
+    for (uint32_t b = 0; b < MEM_TRACK_HIST_BUCKETS; ++b) {
+        if (!hist[b]) continue;
+        if (b == MEM_TRACK_HIST_BUCKETS - 1) {
+            print("  >");
+            serial_write_u32(16u << (b - 1));
+        } else {
+            print("  <=");
+            serial_write_u32(16u << b);
+        }
+        print(": ");
+        serial_write_u32((uint32_t)hist[b]);
+        print("\r\n");
+    }
+}
+
+static void sysinfo_slab(void) {
+    print("cache            objsize  stride  per-slab  slabs  in-use  peak  allocs\r\n");
+    for (struct slab_cache *c = slab_cache_list(); c; c = c->next) {
+        print(c->name);
+        for (size_t pad = strlen(c->name); pad < 17; ++pad) print(" ");
+        serial_write_u32((uint32_t)c->obj_size);
+        print("  ");
+        serial_write_u32((uint32_t)c->stride);
+        print("  ");
+        serial_write_u32(c->objs_per_slab);
+        print("  ");
+        serial_write_u32(c->slabs);
+        print("  ");
+        serial_write_u32(c->in_use);
+        print("  ");
+        serial_write_u32(c->peak_in_use);
+        print("  ");
+        serial_write_u32((uint32_t)c->allocs);
+        print("\r\n");
+    }
+}
+
+static void stat_line(const char *name, uint64_t value) {
+    print("  ");
+    print(name);
+    for (size_t pad = strlen(name); pad < 18; ++pad) print(" ");
+    serial_write_u64(value);
+    print("\r\n");
+}
+
+static void stats_blockdev(const char *label, const struct blockdev *bd) {
+    if (!bd->stats) return;
+    print(label);
+    print(":\r\n");
+    stat_line("reads", bd->stats->reads);
+    stat_line("read bytes", bd->stats->read_bytes);
+    stat_line("writes", bd->stats->writes);
+    stat_line("write bytes", bd->stats->write_bytes);
+    stat_line("zeroed blocks", bd->stats->zeroed_blocks);
+    stat_line("errors", bd->stats->errors);
+}
+
+static void sysinfo_stats(struct storage_state *storage) {
+    stats_blockdev("ram disk", &storage->ram_dev);
+    if (storage->virtio_present) {
+        stats_blockdev("virtio disk", &storage->virtio_dev);
+        stat_line("submits", storage->virtio.stats.submits);
+        stat_line("spins", storage->virtio.stats.spins);
+        stat_line("timeouts", storage->virtio.stats.timeouts);
+        stat_line("device errors", storage->virtio.stats.errors);
+    }
+    if (storage->fs_ready) {
+        print("fs:\r\n");
+        stat_line("inode reads", storage->fs.stats.inode_reads);
+        stat_line("inode writes", storage->fs.stats.inode_writes);
+        stat_line("bitmap syncs", storage->fs.stats.bitmap_syncs);
+        stat_line("superblock writes", storage->fs.stats.superblock_writes);
+        stat_line("checksum errors", storage->fs.stats.csum_errors);
+    }
+    struct mem_stats heap;
+    mem_get_stats(&heap);
+    print("heap:\r\n");
+    stat_line("allocs", heap.allocs);
+    stat_line("frees", heap.frees);
+    stat_line("failures", heap.failures);
+    struct serial_stats uart;
+    serial_get_stats(&uart);
+    print(uart.irq_mode ? "serial (interrupts):\r\n" : "serial (polled):\r\n");
+    stat_line("tx bytes", uart.tx_bytes);
+    stat_line("tx ring stalls", uart.tx_stalls);
+    stat_line("rx bytes", uart.rx_bytes);
+    stat_line("rx dropped", uart.rx_dropped);
+    struct pmm_stats pages;
+    pmm_get_stats(&pages);
+    print("pages:\r\n");
+    stat_line("zero pool hits", pages.zero_pool_hits);
+    stat_line("zero pool misses", pages.zero_pool_misses);
+}
+
+static void sysinfo_latency(struct storage_state *storage, int argc, char **argv) {
+    int buckets = argc > 2 && strcmp(argv[2], "hist") == 0;
+    if (storage->ram_dev.stats) {
+        print("ram disk:\r\n");
+        hist_print("read", &storage->ram_dev.stats->read_lat, buckets);
+        hist_print("write", &storage->ram_dev.stats->write_lat, buckets);
+    }
+    if (storage->virtio_present && storage->virtio_dev.stats) {
+        print("virtio disk:\r\n");
+        hist_print("read", &storage->virtio_dev.stats->read_lat, buckets);
+        hist_print("write", &storage->virtio_dev.stats->write_lat, buckets);
+        hist_print("submit", &storage->virtio.stats.submit_lat, buckets);
+        hist_print("device", &storage->virtio.stats.device_lat, buckets);
+    }
+}
+
+static void stats_reset(struct storage_state *storage) {
+    bd_stats_reset(&storage->ram_dev);
+    bd_stats_reset(&storage->virtio_dev);
+    memset(&storage->virtio.stats, 0, sizeof(storage->virtio.stats));
+    memset(&storage->fs.stats, 0, sizeof(storage->fs.stats));
+    mem_reset_counters();
+    pmm_reset_stats();
+    serial_reset_stats();
+    idle_reset_stats();
+    thread_reset_sched_stats();
+    print("stats reset\r\n");
 }
 
 static void sysinfo_display(const struct aios_boot_info *boot) {
@@ -171,11 +420,141 @@ static void sysinfo_storage(struct storage_state *storage) {
     }
     print("Active backend: ");
     print(storage->using_ram ? "RAM\r\n" : "virtio\r\n");
+    if (storage->fs_ready) {
+        print("Metadata checksums: ");
+        if (storage->fs.meta_crc) {
+            print("on (");
+            serial_write_u32(storage->fs.meta_blocks);
+            print(" blocks, crc32c ");
+            print(crc32c_impl_name());
+            print(")");
+        } else {
+            print("off (image has no checksum table)");
+        }
+        print(" errors: ");
+        serial_write_u64(storage->fs.stats.csum_errors);
+        print("\r\n");
+    }
+}
+
+static void sysinfo_irq(void) {
+    const struct acpi_info *acpi = acpi_get_info();
+    print("Interrupts:\r\n  LAPIC ");
+    print(lapic_present() ? "on, id " : "off");
+    if (lapic_present()) serial_write_u32(lapic_id());
+    print("\r\n  MADT ");
+    if (!acpi->madt_found) {
+        print("not found\r\n");
+        return;
+    }
+    print(acpi->legacy_pics ? "(8259s present, masked)" : "(no 8259s)");
+    print(", CPUs ");
+    serial_write_u32(acpi->cpu_count);
+    print("\r\n");
+    for (uint32_t i = 0; i < acpi->ioapic_count; ++i) {
+        print("  IOAPIC id ");
+        serial_write_u32(acpi->ioapics[i].id);
+        print(" @ 0x");
+        serial_write_hex(acpi->ioapics[i].address);
+        print(" GSI base ");
+        serial_write_u32(acpi->ioapics[i].gsi_base);
+        print("\r\n");
+    }
+    for (uint32_t i = 0; i < acpi->override_count; ++i) {
+        const struct acpi_override *o = &acpi->overrides[i];
+        print("  ISA IRQ ");
+        serial_write_u32(o->isa_irq);
+        print(" -> GSI ");
+        serial_write_u32(o->gsi);
+        print((o->flags & ACPI_INTI_POLARITY_MASK) == ACPI_INTI_ACTIVE_LOW ? " low" : " high");
+        print((o->flags & ACPI_INTI_TRIGGER_MASK) == ACPI_INTI_LEVEL ? " level\r\n" : " edge\r\n");
+    }
+    uint32_t count;
+    const struct irq_line *lines = irq_lines(&count);
+    if (count == 0) print("  no device interrupts registered\r\n");
+    for (uint32_t i = 0; i < count; ++i) {
+        print("  vector ");
+        serial_write_u32(lines[i].vector);
+        print(" GSI ");
+        serial_write_u32(lines[i].gsi);
+        print(" ");
+        print(lines[i].name);
+        print(": ");
+        serial_write_u64(lines[i].count);
+        print("\r\n");
+    }
+}
+
+static void sysinfo_idle(int argc, char **argv) {
+    struct idle_stats idle;
+    idle_get_stats(&idle);
+    uint64_t up = ktime_ns();
+    print("Idle: ");
+    serial_write_u64(idle.halts);
+    print(" halts, ");
+    serial_write_u64(idle.idle_ns / NSEC_PER_MSEC);
+    print(" ms halted of ");
+    serial_write_u64(up / NSEC_PER_MSEC);
+    print(" ms (");
+    serial_write_u32(up ? (uint32_t)(idle.idle_ns * 100u / up) : 0);
+    print("%)\r\n");
+    int buckets = argc > 2 && strcmp(argv[2], "hist") == 0;
+    hist_print("residency", &idle.residency, buckets);
+    hist_print("wakeup", &idle.wakeup, buckets);
+}
+
+static void sysinfo_threads(int argc, char **argv) {
+    if (!thread_running()) {
+        print("Threads not started\r\n");
+        return;
+    }
+    struct sched_stats sched;
+    thread_get_sched_stats(&sched);
+    print("Scheduler: ");
+    if (sched.tick_hz) {
+        print("preemptive, ");
+        serial_write_u32(sched.tick_hz);
+        print(" Hz tick, ");
+        serial_write_u64(sched.quantum_ns / NSEC_PER_MSEC);
+        print(" ms quantum\r\n");
+    } else {
+        print("cooperative\r\n");
+    }
+    print("  ");
+    serial_write_u64(sched.switches);
+    print(" switches, ");
+    serial_write_u64(sched.preemptions);
+    print(" preemptions, ");
+    serial_write_u64(sched.deferred);
+    print(" deferred, ");
+    serial_write_u64(sched.ticks);
+    print(" ticks\r\n");
+    int buckets = argc > 2 && strcmp(argv[2], "hist") == 0;
+    hist_print("run delay", &sched.run_delay, buckets);
+    hist_print("preempt delay", &sched.preempt_delay, buckets);
+    print("Threads (id name prio state switches preempted run-ms):\r\n");
+    for (struct thread *t = thread_list(); t; t = t->all_next) {
+        print("  ");
+        serial_write_u32(t->id);
+        print(" ");
+        print(t->name);
+        print(" ");
+        serial_write_u32(t->priority);
+        print(" ");
+        print(thread_state_name(t->state));
+        print(" ");
+        serial_write_u64(t->switches);
+        print(" ");
+        serial_write_u64(t->preemptions);
+        print(" ");
+        serial_write_u64(t->run_ns / NSEC_PER_MSEC);
+        print("\r\n");
+    }
 }
 
 static void handle_sysinfo(struct shell_env *env, int argc, char **argv) {
     if (argc < 2) {
-        print("usage: sysinfo <ram|storage|display>\r\n");
+        print("usage: sysinfo <ram|heap|storage|display|slab|boot|stats|latency|irq|idle|threads>\r\n");
         return;
     }
     if (strcmp(argv[1], "ram") == 0) {
@@ -184,6 +563,22 @@ static void handle_sysinfo(struct shell_env *env, int argc, char **argv) {
         sysinfo_storage(env->storage);
     } else if (strcmp(argv[1], "display") == 0) {
         sysinfo_display(env->boot);
+    } else if (strcmp(argv[1], "heap") == 0) {
+        sysinfo_heap(argc, argv);
+    } else if (strcmp(argv[1], "slab") == 0) {
+        sysinfo_slab();
+    } else if (strcmp(argv[1], "latency") == 0) {
+        sysinfo_latency(env->storage, argc, argv);
+    } else if (strcmp(argv[1], "stats") == 0) {
+        sysinfo_stats(env->storage);
+    } else if (strcmp(argv[1], "boot") == 0) {
+        boottime_print();
+    } else if (strcmp(argv[1], "irq") == 0) {
+        sysinfo_irq();
+    } else if (strcmp(argv[1], "idle") == 0) {
+        sysinfo_idle(argc, argv);
+    } else if (strcmp(argv[1], "threads") == 0) {
+        sysinfo_threads(argc, argv);
     } else {
         print("unknown sysinfo target\r\n");
     }
@@ -196,13 +591,55 @@ static int copy_seed_to_virtio(struct storage_state *storage) {
     if (blocks > storage->virtio_dev.blocks) blocks = storage->virtio_dev.blocks;
     uint8_t *tmp = (uint8_t *)kalloc(storage->virtio_dev.block_size);
     if (!tmp) return -1;
-    for (uint32_t b = 0; b < blocks; ++b) {
-        if (bd_read(&storage->ram_dev, b, tmp) != 0) return -1;
-        if (bd_write(&storage->virtio_dev, b, tmp) != 0) return -1;
+    int rc = 0;
+    for (uint32_t b = 0; b < blocks && rc == 0; ++b) {
+        if (bd_read(&storage->ram_dev, b, tmp) != 0 || bd_write(&storage->virtio_dev, b, tmp) != 0) rc = -1;
     }
+    kfree(tmp);
+    return rc;
+}
+
+static volatile bool format_running = false; /* background format-disk owns the storage */
+static volatile bool format_done = false;    /* it remounted; the shell resets its cwd */
+
+struct format_job {
+    struct storage_state *storage;
+    bool use_seed;
+};
+
+static struct format_job format_job;
+
+/* Formats (or seeds) and mounts the virtio disk, reporting failures itself. */
+static int format_virtio(struct storage_state *storage, bool use_seed) {
+    if (use_seed) {
+        if (copy_seed_to_virtio(storage) != 0) {
+            print("format-disk: seed copy failed\r\n");
+            return -1;
+        }
+    } else {
+        if (fs_format(&storage->fs, &storage->virtio_dev, 512) != 0) {
+            print("format-disk: format failed\r\n");
+            return -1;
+        }
+    }
+    if (fs_mount(&storage->fs, &storage->virtio_dev) != 0) {
+        print("format-disk: mount failed\r\n");
+        return -1;
+    }
+    storage->fs_ready = true;
+    storage->needs_format = false;
+    storage->using_ram = false;
+    storage->active_dev = &storage->virtio_dev;
+    print("virtio disk ready.\r\n");
     return 0;
 }
 
+static void format_worker(void *arg) {
+    struct format_job *job = (struct format_job *)arg;
+    if (format_virtio(job->storage, job->use_seed) == 0) format_done = true;
+    format_running = false;
+}
+
 static void handle_format_disk(struct shell_env *env, int argc, char **argv, uint32_t *cwd, char *cwd_path) {
     struct storage_state *storage = env->storage;
     if (!storage->virtio_present) {
@@ -210,32 +647,333 @@ static void handle_format_disk(struct shell_env *env, int argc, char **argv, uin
         return;
     }
     bool use_seed = (argc > 1 && strcmp(argv[1], "seed") == 0);
+    bool background = strcmp(argv[argc - 1], "&") == 0;
     if (use_seed && !storage->ram_seed_present) {
         print("format-disk: no seed image available\r\n");
         return;
     }
-    if (use_seed) {
-        if (copy_seed_to_virtio(storage) != 0) {
-            print("format-disk: seed copy failed\r\n");
+    if (background) {
+        format_job.storage = storage;
+        format_job.use_seed = use_seed;
+        format_running = true;
+        if (!thread_create("format", THREAD_PRIO_NORMAL, format_worker, &format_job)) {
+            format_running = false;
+            print("format-disk: cannot start background thread\r\n");
             return;
         }
+        print("format-disk: running in the background\r\n");
+        return;
+    }
+    if (format_virtio(storage, use_seed) != 0) return;
+    *cwd = fs_root_inode(&storage->fs);
+    strcpy(cwd_path, "/");
+}
+
+static void handle_trace(int argc, char **argv) {
+    if (!trace_compiled_in()) {
+        print("trace: not built in (rebuild with AIOS_TRACE=1)\r\n");
+        return;
+    }
+    if (argc > 1 && strcmp(argv[1], "start") == 0) {
+        trace_start();
+        print("trace: recording\r\n");
+    } else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        trace_stop();
+        print("trace: stopped\r\n");
+    } else if (argc > 1 && strcmp(argv[1], "dump") == 0) {
+        trace_dump();
     } else {
-        if (fs_format(&storage->fs, &storage->virtio_dev, 512) != 0) {
-            print("format-disk: format failed\r\n");
+        print("usage: trace <start|stop|dump>\r\n");
+    }
+}
+
+static void handle_record(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "start") == 0) {
+        fsrec_start();
+        print("record: recording file operations\r\n");
+    } else if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        fsrec_stop();
+        print("record: stopped\r\n");
+    } else if (argc > 1 && strcmp(argv[1], "dump") == 0) {
+        fsrec_dump();
+    } else {
+        print("usage: record <start|stop|dump>\r\n");
+    }
+}
+
+/* Hands one timed file operation (started at t0) to the workload recorder. */
+static void record_op(enum fsrec_op op, const char *cwd_path, const char *path, uint32_t length, int rc, uint64_t t0) {
+    uint64_t ns = ktime_ns() - t0;
+    if (!fsrec_active()) return;
+    char abs[PATH_MAX];
+    path_normalize(cwd_path, path, abs);
+    fsrec_add(op, abs, 0, length, rc, ns);
+}
+
+static void run_command(struct shell_env *env, int argc, char **argv, uint32_t *cwd, char *cwd_path);
+
+static uint32_t parse_u32(const char *s) {
+    uint32_t v = 0;
+    for (; *s >= '0' && *s <= '9'; ++s) v = v * 10u + (uint32_t)(*s - '0');
+    return v;
+}
+
+static void handle_sched(int argc, char **argv) {
+    uint32_t ms = argc > 2 && strcmp(argv[1], "quantum") == 0 ? parse_u32(argv[2]) : 0;
+    if (ms == 0) {
+        print("usage: sched quantum <ms>\r\n");
+        return;
+    }
+    thread_set_quantum_ns((uint64_t)ms * NSEC_PER_MSEC);
+    print("sched: quantum ");
+    serial_write_u32(ms);
+    print(" ms\r\n");
+}
+
+/* profile <seconds> [command ...]: repeat the command (or idle) while sampling. */
+static void handle_profile(struct shell_env *env, int argc, char **argv, uint32_t *cwd, char *cwd_path) {
+    if (argc > 1 && strcmp(argv[1], "folded") == 0) {
+        profile_report_folded();
+        return;
+    }
+    uint32_t seconds = argc > 1 ? parse_u32(argv[1]) : 0;
+    if (seconds == 0 || (argc > 2 && strcmp(argv[2], "profile") == 0)) {
+        print("usage: profile <seconds> [command ...] | profile folded\r\n");
+        return;
+    }
+    if (!profile_available()) {
+        print("profile: no usable local APIC timer\r\n");
+        return;
+    }
+    if (profile_start(PROFILE_DEFAULT_HZ) != 0) {
+        print("profile: start failed\r\n");
+        return;
+    }
+    uint64_t deadline = ktime_ns() + (uint64_t)seconds * NSEC_PER_SEC;
+    uint32_t runs = 0;
+    do {
+        if (argc > 2) {
+            run_command(env, argc - 2, argv + 2, cwd, cwd_path);
+            runs++;
+        } else {
+            __asm__ __volatile__("pause");
+        }
+    } while (ktime_ns() < deadline);
+    profile_stop();
+    if (runs) {
+        print("profile: command ran ");
+        serial_write_u32(runs);
+        print(" times\r\n");
+    }
+    profile_report(20);
+}
+
+/* Runs one tokenized command line; "exit" is handled by the caller. */
+static void run_command(struct shell_env *env, int argc, char **argv, uint32_t *cwd, char *cwd_path) {
+    struct storage_state *storage = env->storage;
+    fs_t *fs = &storage->fs;
+
+    if (strcmp(argv[0], "help") == 0) {
+        print("Commands:\r\n");
+        print("  help                - show this list\r\n");
+        print("  exit                - leave the shell\r\n");
+        print("  sysinfo <ram|heap|storage|display|slab|boot|stats|latency|irq|idle|threads> - show system details\r\n");
+        print("  sysinfo idle [hist] - time spent halted, residency and wakeup latency\r\n");
+        print("  sysinfo threads [hist] - threads and scheduler latency\r\n");
+        print("  sched quantum <ms>  - set the preemption time slice\r\n");
+        print("  sysinfo heap [on|off|reset] - heap call-site profiler\r\n");
+        print("  sysinfo latency [hist] - block I/O latency percentiles (and buckets)\r\n");
+        print("  format-disk [seed] [&] - initialize the virtio disk (optionally from RAM seed; & in the background)\r\n");
+        print("  format              - reformat the currently mounted backend\r\n");
+        print("  pwd                 - print current directory\r\n");
+        print("  list [path]         - list directory contents\r\n");
+        print("  make-dir <name>     - create a directory\r\n");
+        print("  delete <name>       - remove a file or directory\r\n");
+        print("  read <file>         - display a file\r\n");
+        print("  write <file>        - edit/create a file (end input with '.')\r\n");
+        print("  goin <path>         - change directory\r\n");
+        print("  stats reset         - zero sysinfo stats/latency counters\r\n");
+        print("  bench [all|fs|io|heap|memcpy] [files] - run microbenchmarks on the active backend\r\n");
+        print("  profile <seconds> [command ...] - sample the kernel while repeating a command\r\n");
+        print("  profile folded      - folded stacks of the last profile (for flame graphs)\r\n");
+        print("  trace <start|stop|dump> - record kernel events (dump for scripts/trace_timeline.py)\r\n");
+        print("  record <start|stop|dump> - record file operations for replay (hostbench -t, fs_shell replay)\r\n");
+        return;
+    }
+    if (strcmp(argv[0], "sysinfo") == 0) {
+        handle_sysinfo(env, argc, argv);
+        return;
+    }
+    if (strcmp(argv[0], "sched") == 0) {
+        handle_sched(argc, argv);
+        return;
+    }
+    if (format_running) {
+        print("[fs] format-disk still running; try again when it is done\r\n");
+        return;
+    }
+    if (strcmp(argv[0], "stats") == 0 && argc > 1 && strcmp(argv[1], "reset") == 0) {
+        stats_reset(storage);
+        return;
+    }
+    if (strcmp(argv[0], "profile") == 0) {
+        handle_profile(env, argc, argv, cwd, cwd_path);
+        return;
+    }
+    if (strcmp(argv[0], "bench") == 0) {
+        bench_run(storage, argc, argv);
+        return;
+    }
+    if (strcmp(argv[0], "trace") == 0) {
+        handle_trace(argc, argv);
+        return;
+    }
+    if (strcmp(argv[0], "record") == 0) {
+        handle_record(argc, argv);
+        return;
+    }
+    if (strcmp(argv[0], "format-disk") == 0) {
+        handle_format_disk(env, argc, argv, cwd, cwd_path);
+        return;
+    }
+    if (strcmp(argv[0], "pwd") == 0) {
+        print(cwd_path);
+        print("\r\n");
+        return;
+    }
+    if (strcmp(argv[0], "format") == 0) {
+        if (!storage->fs_ready) {
+            print("[fs] nothing mounted\r\n");
             return;
         }
+        if (fs_format(fs, storage->active_dev, 256) != 0 || fs_mount(fs, storage->active_dev) != 0) {
+            print("format failed\r\n");
+        } else {
+            *cwd = fs_root_inode(fs);
+            strcpy(cwd_path, "/");
+        }
+        return;
     }
-    if (fs_mount(&storage->fs, &storage->virtio_dev) != 0) {
-        print("format-disk: mount failed\r\n");
+    if (!ensure_fs_ready(storage)) return;
+
+    if (strcmp(argv[0], "list") == 0) {
+        const char *path = (argc > 1) ? argv[1] : ".";
+        struct fs_dirent_disk *ents;
+        size_t count;
+        uint64_t t0 = ktime_ns();
+        if (fs_list_dir(fs, *cwd, path, &ents, &count) != 0) {
+            record_op(FSREC_LIST, cwd_path, path, 0, -1, t0);
+            print("list failed\r\n");
+            return;
+        }
+        size_t live = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (ents[i].inode != 0) live++;
+        }
+        record_op(FSREC_LIST, cwd_path, path, (uint32_t)live, 0, t0);
+        for (size_t i = 0; i < count; ++i) {
+            if (ents[i].inode == 0) continue;
+            print(ents[i].type == FS_INODE_DIR ? "[dir]\t" : "[file]\t");
+            print(ents[i].name);
+            print("\r\n");
+        }
+        kfree(ents);
         return;
     }
-    storage->fs_ready = true;
-    storage->needs_format = false;
-    storage->using_ram = false;
-    storage->active_dev = &storage->virtio_dev;
-    *cwd = fs_root_inode(&storage->fs);
+    if (strcmp(argv[0], "make-dir") == 0 && argc > 1) {
+        uint64_t t0 = ktime_ns();
+        int rc = fs_make_dir(fs, *cwd, argv[1]);
+        record_op(FSREC_MKDIR, cwd_path, argv[1], 0, rc, t0);
+        if (rc != 0) print("make-dir failed\r\n");
+        return;
+    }
+    if (strcmp(argv[0], "delete") == 0 && argc > 1) {
+        uint64_t t0 = ktime_ns();
+        int rc = fs_delete(fs, *cwd, argv[1]);
+        record_op(FSREC_DELETE, cwd_path, argv[1], 0, rc, t0);
+        if (rc != 0) print("delete failed\r\n");
+        return;
+    }
+    if (strcmp(argv[0], "read") == 0 && argc > 1) {
+        struct fs_inode node;
+        uint32_t ino;
+        uint64_t t0 = ktime_ns();
+        if (fs_lookup(fs, *cwd, argv[1], &node, &ino) != 0 || node.type != FS_INODE_FILE) {
+            record_op(FSREC_READ, cwd_path, argv[1], 0, -1, t0);
+            print("read: not found\r\n");
+            return;
+        }
+        size_t to_read = node.size;
+        uint8_t *buf = (uint8_t *)kcalloc(1, to_read + 1);
+        if (!buf) {
+            print("read: out of memory\r\n");
+            return;
+        }
+        size_t got = 0;
+        int rc = fs_read_file(fs, *cwd, argv[1], buf, to_read, 0, &got);
+        record_op(FSREC_READ, cwd_path, argv[1], (uint32_t)got, rc, t0);
+        if (rc != 0) {
+            print("read failed\r\n");
+        } else {
+            buf[got] = '\0';
+            print((char *)buf);
+            print("\r\n");
+        }
+        kfree(buf);
+        return;
+    }
+    if (strcmp(argv[0], "write") == 0 && argc > 1) {
+        print("Enter content, end with a single '.' line\r\n");
+        char line[LINE_MAX];
+        uint8_t buffer[4096];
+        size_t total = 0;
+        while (total + 2 < sizeof(buffer)) {
+            if (read_line(line, sizeof(line)) == 1 && line[0] == '.') break;
+            size_t len = strlen(line);
+            if (total + len + 1 >= sizeof(buffer)) break;
+            memcpy(buffer + total, line, len);
+            total += len;
+            buffer[total++] = '\n';
+        }
+        uint64_t t0 = ktime_ns();
+        if (fs_lookup(fs, *cwd, argv[1], NULL, NULL) != 0) {
+            if (fs_create_file(fs, *cwd, argv[1]) != 0) {
+                record_op(FSREC_WRITE, cwd_path, argv[1], (uint32_t)total, -1, t0);
+                print("write: create failed\r\n");
+                return;
+            }
+        }
+        int rc = fs_write_file(fs, *cwd, argv[1], buffer, total, 0);
+        record_op(FSREC_WRITE, cwd_path, argv[1], (uint32_t)total, rc, t0);
+        if (rc != 0) {
+            print("write failed\r\n");
+        }
+        return;
+    }
+    if (strcmp(argv[0], "goin") == 0 && argc > 1) {
+        struct fs_inode node;
+        uint32_t ino;
+        if (fs_lookup(fs, *cwd, argv[1], &node, &ino) != 0 || node.type != FS_INODE_DIR) {
+            print("goin failed\r\n");
+            return;
+        }
+        char new_path[PATH_MAX];
+        path_normalize(cwd_path, argv[1], new_path);
+        strncpy(cwd_path, new_path, PATH_MAX - 1);
+        cwd_path[PATH_MAX - 1] = '\0';
+        *cwd = ino;
+        return;
+    }
+
+    print("Unknown command\r\n");
+}
+
+/* A background format-disk remounted the disk: start over at its root. */
+static void sync_cwd(fs_t *fs, uint32_t *cwd, char *cwd_path) {
+    if (!format_done) return;
+    format_done = false;
+    *cwd = fs_root_inode(fs);
     strcpy(cwd_path, "/");
-    print("virtio disk ready.\r\n");
 }
 
 void shell_run(struct shell_env *env) {
@@ -256,139 +994,16 @@ void shell_run(struct shell_env *env) {
     int argc;
 
     while (1) {
+        sync_cwd(fs, &cwd, cwd_path);
         print("aios-fs:");
         print(cwd_path);
         print("> ");
         if (read_line(line, sizeof(line)) <= 0) continue;
+        sync_cwd(fs, &cwd, cwd_path);
         argc = tokenize(line, argv, TOKEN_MAX);
         if (argc == 0) continue;
 
         if (strcmp(argv[0], "exit") == 0) break;
-        if (strcmp(argv[0], "help") == 0) {
-            print("Commands:\r\n");
-            print("  help                - show this list\r\n");
-            print("  exit                - leave the shell\r\n");
-            print("  sysinfo <ram|storage|display> - show system details\r\n");
-            print("  format-disk [seed]  - initialize the virtio disk (optionally from RAM seed)\r\n");
-            print("  format              - reformat the currently mounted backend\r\n");
-            print("  pwd                 - print current directory\r\n");
-            print("  list [path]         - list directory contents\r\n");
-            print("  make-dir <name>     - create a directory\r\n");
-            print("  delete <name>       - remove a file or directory\r\n");
-            print("  read <file>         - display a file\r\n");
-            print("  write <file>        - edit/create a file (end input with '.')\r\n");
-            print("  goin <path>         - change directory\r\n");
-            continue;
-        }
-        if (strcmp(argv[0], "sysinfo") == 0) {
-            handle_sysinfo(env, argc, argv);
-            continue;
-        }
-        if (strcmp(argv[0], "format-disk") == 0) {
-            handle_format_disk(env, argc, argv, &cwd, cwd_path);
-            continue;
-        }
-        if (strcmp(argv[0], "pwd") == 0) {
-            print(cwd_path);
-            print("\r\n");
-            continue;
-        }
-        if (strcmp(argv[0], "format") == 0) {
-            if (!storage->fs_ready) {
-                print("[fs] nothing mounted\r\n");
-                continue;
-            }
-            if (fs_format(fs, storage->active_dev, 256) != 0 || fs_mount(fs, storage->active_dev) != 0) {
-                print("format failed\r\n");
-            } else {
-                cwd = fs_root_inode(fs);
-                strcpy(cwd_path, "/");
-            }
-            continue;
-        }
-        if (!ensure_fs_ready(storage)) continue;
-
-        if (strcmp(argv[0], "list") == 0) {
-            const char *path = (argc > 1) ? argv[1] : ".";
-            struct fs_dirent_disk *ents;
-            size_t count;
-            if (fs_list_dir(fs, cwd, path, &ents, &count) != 0) {
-                print("list failed\r\n");
-                continue;
-            }
-            for (size_t i = 0; i < count; ++i) {
-                if (ents[i].inode == 0) continue;
-                print(ents[i].type == FS_INODE_DIR ? "[dir]\t" : "[file]\t");
-                print(ents[i].name);
-                print("\r\n");
-            }
-            continue;
-        }
-        if (strcmp(argv[0], "make-dir") == 0 && argc > 1) {
-            if (fs_make_dir(fs, cwd, argv[1]) != 0) print("make-dir failed\r\n");
-            continue;
-        }
-        if (strcmp(argv[0], "delete") == 0 && argc > 1) {
-            if (fs_delete(fs, cwd, argv[1]) != 0) print("delete failed\r\n");
-            continue;
-        }
-        if (strcmp(argv[0], "read") == 0 && argc > 1) {
-            struct fs_inode node;
-            uint32_t ino;
-            if (fs_lookup(fs, cwd, argv[1], &node, &ino) != 0 || node.type != FS_INODE_FILE) {
-                print("read: not found\r\n");
-                continue;
-            }
-            size_t to_read = node.size;
-            uint8_t *buf = (uint8_t *)kcalloc(1, to_read + 1);
-            size_t got = 0;
-            if (fs_read_file(fs, cwd, argv[1], buf, to_read, 0, &got) != 0) {
-                print("read failed\r\n");
-            } else {
-                buf[got] = '\0';
-                print((char *)buf);
-                print("\r\n");
-            }
-            continue;
-        }
-        if (strcmp(argv[0], "write") == 0 && argc > 1) {
-            print("Enter content, end with a single '.' line\r\n");
-            uint8_t buffer[4096];
-            size_t total = 0;
-            while (total + 2 < sizeof(buffer)) {
-                if (read_line(line, sizeof(line)) == 1 && line[0] == '.') break;
-                size_t len = strlen(line);
-                if (total + len + 1 >= sizeof(buffer)) break;
-                memcpy(buffer + total, line, len);
-                total += len;
-                buffer[total++] = '\n';
-            }
-            if (fs_lookup(fs, cwd, argv[1], NULL, NULL) != 0) {
-                if (fs_create_file(fs, cwd, argv[1]) != 0) {
-                    print("write: create failed\r\n");
-                    continue;
-                }
-            }
-            if (fs_write_file(fs, cwd, argv[1], buffer, total, 0) != 0) {
-                print("write failed\r\n");
-            }
-            continue;
-        }
-        if (strcmp(argv[0], "goin") == 0 && argc > 1) {
-            struct fs_inode node;
-            uint32_t ino;
-            if (fs_lookup(fs, cwd, argv[1], &node, &ino) != 0 || node.type != FS_INODE_DIR) {
-                print("goin failed\r\n");
-                continue;
-            }
-            char new_path[PATH_MAX];
-            path_normalize(cwd_path, argv[1], new_path);
-            strncpy(cwd_path, new_path, PATH_MAX - 1);
-            cwd_path[PATH_MAX - 1] = '\0';
-            cwd = ino;
-            continue;
-        }
-
-        print("Unknown command\r\n");
+        run_command(env, argc, argv, &cwd, cwd_path);
     }
 }
@@ -0,0 +1,202 @@
+#include "slab.h"
+#include "mem.h"
+#include "pmm.h"
+#include "thread.h"
+
+/*
+ * Object caches on top of the kernel heap.
+ *
+ * Each slab is one heap allocation aligned to its own power-of-two size, with
+ * the slab header in the last bytes, so slab_free() finds the header by
+ * masking the object address. Objects sit at the start of the slab at a
+ * cache-line (or caller-chosen) stride. Caches without a constructor keep the
+ * free-list link in the object itself; constructed caches keep it past the
+ * object so the constructed state survives a free.
+ *
+ * Large objects (an eighth of a page or more) would waste a whole slot on
+ * that trailing header and need big aligned heap spans, so their slabs come
+ * straight from the page allocator, naturally aligned, with the header kept
+ * in a separate heap allocation and found by walking the cache's slabs.
+ */
+
+#define SLAB_MIN_BYTES 4096u
+#define SLAB_MIN_OBJECTS 8u
+
+struct slab {
+    struct slab_cache *cache;
+    struct slab *next;
+    struct slab *prev;
+    uint8_t *base;
+    void *free;
+    uint32_t in_use;
+};
+
+static struct slab_cache *caches = NULL;
+
+static size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static size_t slab_header_offset(const struct slab_cache *c) {
+    return c->slab_bytes - align_up(sizeof(struct slab), 16);
+}
+
+static struct slab *find_slab(struct slab *list, uint8_t *base) {
+    for (; list; list = list->next) {
+        if (list->base == base) return list;
+    }
+    return NULL;
+}
+
+static struct slab *slab_of(const struct slab_cache *c, void *obj) {
+    uint8_t *base = (uint8_t *)((uintptr_t)obj & ~((uintptr_t)c->slab_bytes - 1));
+    if (!c->off_slab) return (struct slab *)(base + slab_header_offset(c));
+    struct slab *s = find_slab(c->partial, base);
+    if (!s) s = find_slab(c->full, base);
+    return s;
+}
+
+static void **link_of(const struct slab_cache *c, void *obj) {
+    return (void **)((uint8_t *)obj + c->link_offset);
+}
+
+static void list_add(struct slab **head, struct slab *s) {
+    s->prev = NULL;
+    s->next = *head;
+    if (*head) (*head)->prev = s;
+    *head = s;
+}
+
+static void list_del(struct slab **head, struct slab *s) {
+    if (s->prev) s->prev->next = s->next;
+    else *head = s->next;
+    if (s->next) s->next->prev = s->prev;
+    s->next = s->prev = NULL;
+}
+
+struct slab_cache *slab_cache_create(const char *name, size_t size, size_t align, slab_ctor_fn ctor) {
+    if (size == 0) return NULL;
+    if (align < SLAB_CACHE_LINE) align = SLAB_CACHE_LINE;
+    struct slab_cache *c = (struct slab_cache *)kcalloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->name = name;
+    c->obj_size = size;
+    c->ctor = ctor;
+    c->link_offset = ctor ? align_up(size, sizeof(void *)) : 0;
+    size_t footprint = ctor ? c->link_offset + sizeof(void *) : size;
+    if (footprint < sizeof(void *)) footprint = sizeof(void *);
+    c->stride = align_up(footprint, align);
+
+    c->off_slab = c->stride >= SLAB_MIN_BYTES / SLAB_MIN_OBJECTS;
+    size_t header = c->off_slab ? 0 : align_up(sizeof(struct slab), 16);
+    c->slab_bytes = SLAB_MIN_BYTES;
+    while ((c->slab_bytes - header) / c->stride < SLAB_MIN_OBJECTS) c->slab_bytes <<= 1;
+    c->objs_per_slab = (uint32_t)((c->slab_bytes - header) / c->stride);
+
+    c->next = caches;
+    caches = c;
+    return c;
+}
+
+static struct slab *slab_grow(struct slab_cache *c) {
+    uint8_t *mem;
+    struct slab *s;
+    if (c->off_slab) {
+        s = (struct slab *)kalloc(sizeof(*s));
+        if (!s) return NULL;
+        mem = (uint8_t *)pmm_alloc_pages(pmm_order_for(c->slab_bytes));
+        if (!mem) {
+            kfree(s);
+            return NULL;
+        }
+    } else {
+        mem = (uint8_t *)kalloc_aligned(c->slab_bytes, c->slab_bytes);
+        if (!mem) return NULL;
+        s = (struct slab *)(mem + slab_header_offset(c));
+    }
+    s->base = mem;
+    s->next = s->prev = NULL;
+    s->cache = c;
+    s->in_use = 0;
+    s->free = NULL;
+    for (uint32_t i = c->objs_per_slab; i-- > 0;) {
+        void *obj = mem + (size_t)i * c->stride;
+        if (c->ctor) c->ctor(obj);
+        *link_of(c, obj) = s->free;
+        s->free = obj;
+    }
+    c->slabs++;
+    return s;
+}
+
+static void *cache_alloc(struct slab_cache *c) {
+    struct slab *s = c->partial;
+    if (!s) {
+        s = c->empty;
+        if (s) {
+            c->empty = NULL;
+        } else {
+            s = slab_grow(c);
+            if (!s) return NULL;
+        }
+        list_add(&c->partial, s);
+    }
+    void *obj = s->free;
+    s->free = *link_of(c, obj);
+    s->in_use++;
+    if (s->in_use == c->objs_per_slab) {
+        list_del(&c->partial, s);
+        list_add(&c->full, s);
+    }
+    c->allocs++;
+    c->in_use++;
+    if (c->in_use > c->peak_in_use) c->peak_in_use = c->in_use;
+    return obj;
+}
+
+static void cache_free(struct slab_cache *c, void *obj) {
+    struct slab *s = slab_of(c, obj);
+    if (!s || s->cache != c) return; /* not from this cache */
+    if (s->in_use == c->objs_per_slab) {
+        list_del(&c->full, s);
+        list_add(&c->partial, s);
+    }
+    *link_of(c, obj) = s->free;
+    s->free = obj;
+    s->in_use--;
+    c->frees++;
+    c->in_use--;
+    if (s->in_use == 0) {
+        list_del(&c->partial, s);
+        if (c->empty) {
+            if (c->off_slab) {
+                pmm_free_pages(s->base, pmm_order_for(c->slab_bytes));
+                kfree(s);
+            } else {
+                kfree(s->base);
+            }
+            c->slabs--;
+        } else {
+            c->empty = s;
+        }
+    }
+}
+
+/* Caches are shared between threads. */
+void *slab_alloc(struct slab_cache *c) {
+    preempt_disable();
+    void *obj = cache_alloc(c);
+    preempt_enable();
+    return obj;
+}
+
+void slab_free(struct slab_cache *c, void *obj) {
+    if (!obj) return;
+    preempt_disable();
+    cache_free(c, obj);
+    preempt_enable();
+}
+
+struct slab_cache *slab_cache_list(void) {
+    return caches;
+}
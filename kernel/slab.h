@@ -0,0 +1,41 @@
+#ifndef AIOS_KERNEL_SLAB_H
+#define AIOS_KERNEL_SLAB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLAB_CACHE_LINE 64u
+
+typedef void (*slab_ctor_fn)(void *obj);
+
+struct slab;
+
+struct slab_cache {
+    const char *name;
+    size_t obj_size;      /* caller-visible size */
+    size_t stride;        /* distance between objects */
+    size_t link_offset;   /* where a free object keeps its free-list link */
+    size_t slab_bytes;    /* power of two; slabs are aligned to it */
+    uint32_t objs_per_slab;
+    bool off_slab;        /* page-allocator slabs with the header kept apart */
+    slab_ctor_fn ctor;
+    struct slab *partial;
+    struct slab *full;
+    struct slab *empty;   /* at most one, kept to avoid heap churn */
+    uint64_t allocs;
+    uint64_t frees;
+    uint32_t slabs;
+    uint32_t in_use;
+    uint32_t peak_in_use;
+    struct slab_cache *next;
+};
+
+/* align: 0 means SLAB_CACHE_LINE. The constructor runs once per object when
+ * its slab is created; freed objects must be returned in constructed state. */
+struct slab_cache *slab_cache_create(const char *name, size_t size, size_t align, slab_ctor_fn ctor);
+void *slab_alloc(struct slab_cache *cache);
+void slab_free(struct slab_cache *cache, void *obj);
+struct slab_cache *slab_cache_list(void);
+
+#endif
@@ -0,0 +1,433 @@
+#include "thread.h"
+#include "cpu.h"
+#include "idle.h"
+#include "idt.h"
+#include "lapic.h"
+#include "mem.h"
+#include "pmm.h"
+#include "time.h"
+#include "util.h"
+
+#define RFLAGS_IF (1ull << 9)
+
+/* switch.S */
+void thread_switch(uint64_t *save_rsp, uint64_t next_rsp);
+void thread_trampoline(void);
+
+struct run_queue {
+    struct thread *head[THREAD_PRIORITIES];
+    struct thread *tail[THREAD_PRIORITIES];
+};
+
+/* Scheduler state of one CPU; only the boot CPU is brought up. */
+struct cpu_sched {
+    struct run_queue rq;
+    struct thread *current;
+    struct thread *idle;
+    struct thread *zombie;   /* exited; freed by whoever runs next */
+    bool need_resched;
+    uint64_t resched_tsc;
+};
+
+static struct cpu_sched boot_cpu;
+static struct thread boot_thread;
+static struct thread *sleepers = NULL;
+static struct thread *all_head = NULL, *all_tail = NULL;
+static uint32_t next_id = 0;
+static uint32_t tick_hz = 0;
+static uint64_t quantum_ns = THREAD_QUANTUM_MS_DEFAULT * NSEC_PER_MSEC;
+static struct sched_stats stats;
+
+static struct cpu_sched *this_cpu(void) {
+    return &boot_cpu;
+}
+
+static void request_resched(struct cpu_sched *cpu) {
+    if (cpu->need_resched) return;
+    cpu->need_resched = true;
+    cpu->resched_tsc = rdtsc();
+}
+
+static void run_push(struct cpu_sched *cpu, struct thread *t) {
+    t->state = THREAD_READY;
+    t->ready_tsc = rdtsc();
+    t->next = NULL;
+    struct run_queue *rq = &cpu->rq;
+    if (rq->tail[t->priority]) rq->tail[t->priority]->next = t;
+    else rq->head[t->priority] = t;
+    rq->tail[t->priority] = t;
+    struct thread *cur = cpu->current;
+    if (cur && cur != cpu->idle && t->priority < cur->priority) request_resched(cpu);
+}
+
+/* Highest priority with a runnable thread, or THREAD_PRIORITIES. */
+static unsigned run_best(const struct cpu_sched *cpu) {
+    unsigned p = 0;
+    while (p < THREAD_PRIORITIES && !cpu->rq.head[p]) p++;
+    return p;
+}
+
+static struct thread *run_pop(struct cpu_sched *cpu) {
+    unsigned p = run_best(cpu);
+    if (p == THREAD_PRIORITIES) return NULL;
+    struct run_queue *rq = &cpu->rq;
+    struct thread *t = rq->head[p];
+    rq->head[p] = t->next;
+    if (!rq->head[p]) rq->tail[p] = NULL;
+    t->next = NULL;
+    return t;
+}
+
+static void add_to_all(struct thread *t) {
+    t->id = next_id++;
+    if (all_tail) all_tail->all_next = t;
+    else all_head = t;
+    all_tail = t;
+}
+
+static void wake_sleepers(struct cpu_sched *cpu) {
+    if (!sleepers) return;
+    uint64_t now = ktime_ns();
+    struct thread **link = &sleepers;
+    while (*link) {
+        struct thread *t = *link;
+        if (t->wake_ns <= now) {
+            *link = t->next;
+            run_push(cpu, t);
+        } else {
+            link = &t->next;
+        }
+    }
+}
+
+static void reap(struct cpu_sched *cpu) {
+    struct thread *t = cpu->zombie;
+    if (!t) return;
+    cpu->zombie = NULL;
+    struct thread **link = &all_head;
+    struct thread *prev = NULL;
+    while (*link && *link != t) {
+        prev = *link;
+        link = &(*link)->all_next;
+    }
+    if (*link) *link = t->all_next;
+    if (all_tail == t) all_tail = prev;
+    pmm_free_pages(t->stack, THREAD_STACK_ORDER);
+    kfree(t->simd);
+    kfree(t);
+}
+
+/*
+ * Pick the next thread and switch to it; interrupts are off. The current
+ * thread has already been queued wherever it is waiting unless it is
+ * still RUNNING, in which case it keeps the CPU if nothing of equal or
+ * higher priority is ready, and otherwise goes to the back of its level.
+ * The idle thread is never queued: it runs only when nothing else can.
+ */
+static void schedule(void) {
+    struct cpu_sched *cpu = this_cpu();
+    wake_sleepers(cpu);
+    cpu->need_resched = false;
+    struct thread *prev = cpu->current;
+    if (prev->state == THREAD_RUNNING && prev != cpu->idle && run_best(cpu) > prev->priority) return;
+    struct thread *next = run_pop(cpu);
+    if (!next) {
+        if (prev->state == THREAD_RUNNING) return;
+        next = cpu->idle;
+    }
+    if (prev->state == THREAD_RUNNING) {
+        if (prev == cpu->idle) prev->state = THREAD_READY;
+        else run_push(cpu, prev);
+    }
+    uint64_t now = rdtsc();
+    prev->run_ns += tsc_to_ns(now - prev->last_tsc);
+    if (next != cpu->idle) hist_add(&stats.run_delay, tsc_to_ns(now - next->ready_tsc));
+    next->last_tsc = now;
+    next->state = THREAD_RUNNING;
+    next->switches++;
+    stats.switches++;
+    cpu->current = next;
+    thread_switch(&prev->rsp, next->rsp);
+    reap(this_cpu());
+}
+
+/*
+ * Involuntary switch; interrupts are off. From an interrupt the vector
+ * registers still belong to the interrupted code, so they are saved
+ * before any C code can touch them.
+ */
+static void preempt(struct cpu_sched *cpu, bool from_irq) {
+    struct thread *self = cpu->current;
+    if (from_irq) cpu_simd_save(self->simd);
+    hist_add(&stats.preempt_delay, tsc_to_ns(rdtsc() - cpu->resched_tsc));
+    stats.preemptions++;
+    self->preemptions++;
+    schedule();
+    if (from_irq) cpu_simd_restore(self->simd);
+}
+
+/* First code a new thread runs, entered from thread_trampoline. */
+static void thread_start(struct thread *self) {
+    reap(this_cpu());
+    irq_enable();
+    self->entry(self->arg);
+    thread_exit();
+}
+
+static void idle_loop(void *arg) {
+    (void)arg;
+    struct cpu_sched *cpu = this_cpu();
+    for (;;) {
+        irq_disable();
+        /* Without the tick nothing would wake a sleeper, so poll. */
+        if (run_best(cpu) == THREAD_PRIORITIES && (!sleepers || tick_hz)) {
+            cpu_idle();
+        } else {
+            irq_enable();
+            __asm__ __volatile__("pause");
+        }
+        thread_yield();
+    }
+}
+
+static void *simd_alloc(void) {
+    uint32_t size = cpu_get_features()->simd_state_size;
+    void *area = kalloc_aligned(size, 64);
+    if (area) memset(area, 0, size);
+    return area;
+}
+
+static struct thread *thread_alloc(const char *name, enum thread_priority priority,
+                                   void (*entry)(void *arg), void *arg) {
+    struct thread *t = (struct thread *)kcalloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->stack = pmm_alloc_pages(THREAD_STACK_ORDER);
+    t->simd = simd_alloc();
+    if (!t->stack || !t->simd) {
+        pmm_free_pages(t->stack, THREAD_STACK_ORDER);
+        kfree(t->simd);
+        kfree(t);
+        return NULL;
+    }
+    t->name = name;
+    t->priority = priority;
+    t->entry = entry;
+    t->arg = arg;
+
+    /* The frame thread_switch() pops: r15..r12, rbx, rbp, then the return address. */
+    uint64_t *sp = (uint64_t *)((uint8_t *)t->stack + ((size_t)PAGE_SIZE << THREAD_STACK_ORDER));
+    *--sp = (uint64_t)(uintptr_t)thread_trampoline;
+    *--sp = 0;                                 /* rbp: ends frame-pointer walks */
+    *--sp = (uint64_t)(uintptr_t)thread_start; /* rbx */
+    *--sp = (uint64_t)(uintptr_t)t;            /* r12 */
+    *--sp = 0;
+    *--sp = 0;
+    *--sp = 0;
+    t->rsp = (uint64_t)(uintptr_t)sp;
+    return t;
+}
+
+int thread_init(const char *boot_thread_name, enum thread_priority priority) {
+    struct cpu_sched *cpu = this_cpu();
+    if (cpu->current) return 0;
+    struct thread *idle = thread_alloc("idle", THREAD_PRIO_LOW, idle_loop, NULL);
+    void *simd = simd_alloc();
+    if (!idle || !simd) {
+        kfree(simd);
+        return -1;
+    }
+    uint64_t flags = irq_save();
+    boot_thread.name = boot_thread_name;
+    boot_thread.priority = priority;
+    boot_thread.simd = simd;
+    boot_thread.state = THREAD_RUNNING;
+    boot_thread.switches = 1;
+    boot_thread.last_tsc = rdtsc();
+    add_to_all(&boot_thread);
+    idle->state = THREAD_READY;
+    add_to_all(idle);
+    cpu->idle = idle;
+    cpu->current = &boot_thread;
+    stats.quantum_ns = quantum_ns;
+    irq_restore(flags);
+    return 0;
+}
+
+bool thread_running(void) {
+    return this_cpu()->current != NULL;
+}
+
+struct thread *thread_current(void) {
+    return this_cpu()->current;
+}
+
+struct thread *thread_create(const char *name, enum thread_priority priority,
+                             void (*entry)(void *arg), void *arg) {
+    if (!thread_running() || priority >= THREAD_PRIORITIES) return NULL;
+    struct thread *t = thread_alloc(name, priority, entry, arg);
+    if (!t) return NULL;
+    uint64_t flags = irq_save();
+    add_to_all(t);
+    run_push(this_cpu(), t);
+    irq_restore(flags);
+    return t;
+}
+
+void thread_yield(void) {
+    if (!thread_running()) return;
+    uint64_t flags = irq_save();
+    schedule();
+    irq_restore(flags);
+}
+
+void thread_sleep_ns(uint64_t ns) {
+    struct thread *self = thread_current();
+    if (!self) return;
+    uint64_t flags = irq_save();
+    self->wake_ns = ktime_ns() + ns;
+    self->state = THREAD_SLEEPING;
+    self->next = sleepers;
+    sleepers = self;
+    schedule();
+    irq_restore(flags);
+}
+
+void thread_exit(void) {
+    irq_disable();
+    struct cpu_sched *cpu = this_cpu();
+    if (cpu->current == &boot_thread || cpu->current == cpu->idle) {
+        for (;;) { __asm__ __volatile__("hlt"); }
+    }
+    cpu->current->state = THREAD_DEAD;
+    cpu->zombie = cpu->current;
+    schedule();
+    __builtin_unreachable();
+}
+
+struct thread *thread_list(void) {
+    return all_head;
+}
+
+const char *thread_state_name(enum thread_state state) {
+    switch (state) {
+    case THREAD_READY: return "ready";
+    case THREAD_RUNNING: return "running";
+    case THREAD_BLOCKED: return "blocked";
+    case THREAD_SLEEPING: return "sleeping";
+    case THREAD_DEAD: return "dead";
+    }
+    return "?";
+}
+
+void preempt_disable(void) {
+    struct thread *self = thread_current();
+    if (self) self->preempt_count++;
+}
+
+void preempt_enable(void) {
+    struct cpu_sched *cpu = this_cpu();
+    struct thread *self = cpu->current;
+    if (!self || --self->preempt_count || !cpu->need_resched || !irq_enabled()) return;
+    irq_disable();
+    if (cpu->need_resched) preempt(cpu, false);
+    irq_enable();
+}
+
+static void on_tick(struct interrupt_frame *frame) {
+    (void)frame;
+    thread_tick(true);
+    lapic_eoi();
+}
+
+int thread_timer_start(uint32_t hz) {
+    if (!thread_running() || !lapic_present() || !lapic_timer_hz() || hz == 0) return -1;
+    tick_hz = hz;
+    stats.tick_hz = hz;
+    thread_timer_resume();
+    return 0;
+}
+
+void thread_timer_resume(void) {
+    if (!tick_hz) return;
+    idt_set_handler(IRQ_VECTOR_TIMER, on_tick);
+    lapic_timer_start(tick_hz, IRQ_VECTOR_TIMER);
+}
+
+void thread_tick(bool sched_tick) {
+    struct cpu_sched *cpu = this_cpu();
+    struct thread *self = cpu->current;
+    if (!self) return;
+    if (sched_tick) stats.ticks++;
+    wake_sleepers(cpu);
+    if (self == cpu->idle) return;
+    if (tsc_to_ns(rdtsc() - self->last_tsc) >= quantum_ns && run_best(cpu) <= self->priority) {
+        request_resched(cpu);
+    }
+}
+
+void thread_irq_exit(const struct interrupt_frame *frame) {
+    struct cpu_sched *cpu = this_cpu();
+    struct thread *self = cpu->current;
+    if (!cpu->need_resched || !self || self == cpu->idle || !(frame->rflags & RFLAGS_IF)) return;
+    if (self->preempt_count) {
+        stats.deferred++;
+        return;
+    }
+    preempt(cpu, true);
+}
+
+void thread_set_quantum_ns(uint64_t ns) {
+    quantum_ns = ns;
+    stats.quantum_ns = ns;
+}
+
+void thread_get_sched_stats(struct sched_stats *out) {
+    uint64_t flags = irq_save();
+    *out = stats;
+    irq_restore(flags);
+}
+
+void thread_reset_sched_stats(void) {
+    uint64_t flags = irq_save();
+    stats.ticks = 0;
+    stats.switches = 0;
+    stats.preemptions = 0;
+    stats.deferred = 0;
+    memset(&stats.run_delay, 0, sizeof(stats.run_delay));
+    memset(&stats.preempt_delay, 0, sizeof(stats.preempt_delay));
+    irq_restore(flags);
+}
+
+void wait_queue_init(struct wait_queue *wq) {
+    wq->head = NULL;
+    wq->tail = NULL;
+}
+
+void wait_queue_wait(struct wait_queue *wq) {
+    struct thread *t = thread_current();
+    t->state = THREAD_BLOCKED;
+    t->next = NULL;
+    if (wq->tail) wq->tail->next = t;
+    else wq->head = t;
+    wq->tail = t;
+    schedule();
+    irq_enable();
+}
+
+int wait_queue_wake_one(struct wait_queue *wq) {
+    uint64_t flags = irq_save();
+    struct thread *t = wq->head;
+    if (t) {
+        wq->head = t->next;
+        if (!wq->head) wq->tail = NULL;
+        run_push(this_cpu(), t);
+    }
+    irq_restore(flags);
+    return t != NULL;
+}
+
+int wait_queue_wake_all(struct wait_queue *wq) {
+    int woken = 0;
+    while (wait_queue_wake_one(wq)) woken++;
+    return woken;
+}
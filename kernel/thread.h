@@ -0,0 +1,121 @@
+#ifndef AIOS_KERNEL_THREAD_H
+#define AIOS_KERNEL_THREAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hist.h"
+
+struct interrupt_frame;
+
+#define THREAD_STACK_ORDER 2 /* 16 KiB */
+#define THREAD_TICK_HZ 250
+#define THREAD_QUANTUM_MS_DEFAULT 10
+
+enum thread_priority {
+    THREAD_PRIO_HIGH,   /* interactive: the shell */
+    THREAD_PRIO_NORMAL,
+    THREAD_PRIO_LOW,    /* background housekeeping */
+    THREAD_PRIORITIES,
+};
+
+enum thread_state {
+    THREAD_READY,
+    THREAD_RUNNING,
+    THREAD_BLOCKED,  /* on a wait queue */
+    THREAD_SLEEPING,
+    THREAD_DEAD,
+};
+
+struct thread {
+    uint64_t rsp;            /* saved by thread_switch(); must stay first */
+    uint32_t id;
+    const char *name;
+    enum thread_state state;
+    enum thread_priority priority;
+    uint32_t preempt_count;  /* preempt_disable() depth */
+    void (*entry)(void *arg);
+    void *arg;
+    void *stack;             /* NULL for the boot thread */
+    void *simd;              /* vector state while preempted */
+    uint64_t wake_ns;        /* THREAD_SLEEPING deadline */
+    struct thread *next;     /* run queue, wait queue or sleeper list */
+    struct thread *all_next;
+    uint64_t switches;       /* times switched in */
+    uint64_t preemptions;    /* times switched out by the timer or a wakeup */
+    uint64_t run_ns;
+    uint64_t last_tsc;       /* when it was last switched in */
+    uint64_t ready_tsc;      /* when it last became runnable */
+};
+
+struct wait_queue {
+    struct thread *head;
+    struct thread *tail;
+};
+
+struct sched_stats {
+    uint32_t tick_hz;         /* 0 while cooperative */
+    uint64_t quantum_ns;
+    uint64_t ticks;
+    uint64_t switches;
+    uint64_t preemptions;
+    uint64_t deferred;        /* preemption held off by preempt_disable() */
+    struct hist run_delay;    /* runnable until running */
+    struct hist preempt_delay; /* preemption requested until it happened */
+};
+
+/*
+ * Kernel threads on the boot CPU. thread_init() turns the calling context
+ * (the boot stack) into the first thread and starts an idle thread that
+ * halts when nothing is runnable. The run queue is strict priority with
+ * round robin inside a level.
+ *
+ * Until thread_timer_start() threads are cooperative: they run until they
+ * yield, sleep, block on a wait queue or exit. With the timer running, a
+ * thread that used up its quantum, or was outranked by a wakeup, is
+ * switched out when the interrupt returns. Code running with interrupts
+ * off is never preempted; preempt_disable() holds preemption off while
+ * leaving interrupts on, and the switch happens at preempt_enable().
+ */
+int thread_init(const char *boot_thread_name, enum thread_priority priority);
+bool thread_running(void); /* thread_init() has run */
+struct thread *thread_current(void);
+struct thread *thread_create(const char *name, enum thread_priority priority,
+                             void (*entry)(void *arg), void *arg);
+void thread_yield(void);
+void thread_sleep_ns(uint64_t ns);
+void thread_exit(void);
+/* All threads, oldest first, for reporting. */
+struct thread *thread_list(void);
+const char *thread_state_name(enum thread_state state);
+
+void preempt_disable(void);
+void preempt_enable(void);
+
+/* Periodic scheduler tick on the LAPIC timer; enables preemption. */
+int thread_timer_start(uint32_t hz);
+/* Reinstall the scheduler tick after the profiler borrowed the timer. */
+void thread_timer_resume(void);
+/*
+ * Timer bookkeeping: wake sleepers, check the quantum. Interrupt context.
+ * sched_tick is false when another timer user (the profiler) drives it, so
+ * only the scheduler's own ticks are counted.
+ */
+void thread_tick(bool sched_tick);
+/* Called as interrupt_dispatch() returns; switches if a preemption is due. */
+void thread_irq_exit(const struct interrupt_frame *frame);
+void thread_set_quantum_ns(uint64_t ns);
+void thread_get_sched_stats(struct sched_stats *out);
+void thread_reset_sched_stats(void);
+
+void wait_queue_init(struct wait_queue *wq);
+/*
+ * Block the current thread on wq. Call with interrupts disabled after
+ * checking the wait condition, as with cpu_idle(); returns with interrupts
+ * enabled once woken.
+ */
+void wait_queue_wait(struct wait_queue *wq);
+/* Safe from interrupt handlers. Return the number of threads woken. */
+int wait_queue_wake_one(struct wait_queue *wq);
+int wait_queue_wake_all(struct wait_queue *wq);
+
+#endif
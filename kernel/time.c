@@ -0,0 +1,114 @@
+#include "time.h"
+#include "cpu.h"
+#include "io.h"
+
+/*
+ * Calibration prefers CPUID leaf 0x15 (TSC/crystal ratio) when the CPU
+ * reports the crystal frequency, and otherwise counts TSC ticks across a
+ * PIT channel 2 one-shot. Channel 2 is gated through port 0x61 and its
+ * output can be polled there, so no interrupt is needed. The best of a
+ * few short runs filters out VM exits that land inside a measurement.
+ */
+
+#define PIT_HZ            1193182u
+#define PIT_CH2_DATA      0x42
+#define PIT_COMMAND       0x43
+#define PIT_GATE_PORT     0x61
+#define PIT_GATE_CH2      0x01
+#define PIT_SPEAKER       0x02
+#define PIT_OUT2          0x20
+#define CALIBRATE_MS      10u
+#define CALIBRATE_RUNS    3
+#define NOMINAL_TSC_HZ    2000000000ull /* until calibrated */
+
+static uint64_t tsc_hz = NOMINAL_TSC_HZ;
+static uint64_t ns_mult = 0;  /* ns = cycles * ns_mult >> 32 */
+static uint64_t tsc_base = 0;
+static const char *source = "assumed";
+
+static void set_rate(uint64_t hz) {
+    tsc_hz = hz;
+    ns_mult = (NSEC_PER_SEC << 32) / hz;
+}
+
+static uint64_t calibrate_cpuid(void) {
+    const struct cpu_features *cpu = cpu_get_features();
+    if (cpu->max_leaf < 0x15) return 0;
+    uint32_t a, b, c, d;
+    cpuid(0x15, 0, &a, &b, &c, &d);
+    if (a == 0 || b == 0 || c == 0) return 0;
+    return (uint64_t)c * b / a;
+}
+
+/* TSC cycles elapsed while the PIT counts down `ms` milliseconds. */
+static uint64_t pit_measure(uint32_t ms) {
+    uint32_t count = PIT_HZ / 1000u * ms;
+    uint8_t gate = inb_port(PIT_GATE_PORT);
+    outb(PIT_GATE_PORT, (uint8_t)((gate & ~PIT_SPEAKER) & ~PIT_GATE_CH2));
+    outb(PIT_COMMAND, 0xB0); /* channel 2, lobyte/hibyte, mode 0 */
+    outb(PIT_CH2_DATA, (uint8_t)(count & 0xFF));
+    outb(PIT_CH2_DATA, (uint8_t)(count >> 8));
+    outb(PIT_GATE_PORT, (uint8_t)((gate & ~PIT_SPEAKER) | PIT_GATE_CH2));
+
+    uint64_t start = rdtsc();
+    uint64_t limit = start + NOMINAL_TSC_HZ; /* ~1 s even on a slow TSC */
+    uint64_t now = start;
+    while (!(inb_port(PIT_GATE_PORT) & PIT_OUT2)) {
+        now = rdtsc();
+        if (now > limit) {
+            now = 0;
+            break;
+        }
+    }
+    outb(PIT_GATE_PORT, gate);
+    return now ? now - start : 0;
+}
+
+static uint64_t calibrate_pit(void) {
+    uint64_t best = 0;
+    for (int i = 0; i < CALIBRATE_RUNS; ++i) {
+        uint64_t cycles = pit_measure(CALIBRATE_MS);
+        if (cycles && (best == 0 || cycles < best)) best = cycles;
+    }
+    return best ? best * (1000u / CALIBRATE_MS) : 0;
+}
+
+int time_init(void) {
+    tsc_base = rdtsc();
+    set_rate(NOMINAL_TSC_HZ);
+    if (!cpu_get_features()->tsc) return -1;
+    uint64_t hz = calibrate_cpuid();
+    if (hz) {
+        source = "cpuid";
+    } else {
+        hz = calibrate_pit();
+        if (!hz) return -1;
+        source = "pit";
+    }
+    set_rate(hz);
+    return 0;
+}
+
+uint64_t tsc_to_ns(uint64_t cycles) {
+    if (!ns_mult) set_rate(tsc_hz);
+    return (uint64_t)(((unsigned __int128)cycles * ns_mult) >> 32);
+}
+
+uint64_t ktime_ns(void) {
+    return tsc_to_ns(rdtsc() - tsc_base);
+}
+
+void udelay(uint32_t us) {
+    uint64_t end = ktime_ns() + (uint64_t)us * NSEC_PER_USEC;
+    while (ktime_ns() < end) {
+        __asm__ __volatile__("pause");
+    }
+}
+
+uint64_t time_tsc_hz(void) {
+    return tsc_hz;
+}
+
+const char *time_source_name(void) {
+    return source;
+}
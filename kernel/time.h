@@ -0,0 +1,22 @@
+#ifndef AIOS_KERNEL_TIME_H
+#define AIOS_KERNEL_TIME_H
+
+#include <stdint.h>
+
+#define NSEC_PER_USEC 1000ull
+#define NSEC_PER_MSEC 1000000ull
+#define NSEC_PER_SEC  1000000000ull
+
+/*
+ * TSC clocksource. time_init() calibrates the TSC once at boot; until then
+ * (or if calibration fails) a nominal rate is assumed so that timeouts
+ * still terminate.
+ */
+int time_init(void);
+uint64_t ktime_ns(void);                 /* nanoseconds since time_init() */
+uint64_t tsc_to_ns(uint64_t cycles);
+void udelay(uint32_t us);
+uint64_t time_tsc_hz(void);
+const char *time_source_name(void);
+
+#endif
@@ -0,0 +1,104 @@
+#include "trace.h"
+#include "serial.h"
+#include "time.h"
+#include "cpu.h"
+
+#define TRACE_MAX_CPUS 1
+#define TRACE_RING_EVENTS 4096u /* power of two; 128 KiB per CPU */
+
+static const char *const trace_names[TRACE_EVENT_COUNT] = {
+    [TRACE_FS_OP_BEGIN] = "fs.op.b",
+    [TRACE_FS_OP_END] = "fs.op.e",
+    [TRACE_FS_RESOLVE_BEGIN] = "fs.resolve.b",
+    [TRACE_FS_RESOLVE_END] = "fs.resolve.e",
+    [TRACE_FS_BITMAP_SYNC] = "fs.bitmap_sync",
+    [TRACE_FS_META_FLUSH] = "fs.meta_flush",
+    [TRACE_BD_READ_BEGIN] = "bd.read.b",
+    [TRACE_BD_READ_END] = "bd.read.e",
+    [TRACE_BD_WRITE_BEGIN] = "bd.write.b",
+    [TRACE_BD_WRITE_END] = "bd.write.e",
+    [TRACE_VIRTIO_SUBMIT] = "virtio.submit",
+    [TRACE_VIRTIO_COMPLETE] = "virtio.complete",
+};
+
+#ifdef AIOS_TRACE
+
+struct trace_ring {
+    struct trace_event events[TRACE_RING_EVENTS];
+    uint64_t written; /* total ever written; head = written % size */
+};
+
+static struct trace_ring rings[TRACE_MAX_CPUS];
+static bool recording = false;
+static uint64_t start_tsc = 0;
+
+void trace_emit(uint16_t id, uint64_t a, uint64_t b) {
+    if (!recording) return;
+    struct trace_ring *ring = &rings[0];
+    struct trace_event *ev = &ring->events[ring->written & (TRACE_RING_EVENTS - 1)];
+    ev->tsc = rdtsc();
+    ev->id = id;
+    ev->cpu = 0;
+    ev->a = a;
+    ev->b = b;
+    ring->written++;
+}
+
+bool trace_compiled_in(void) { return true; }
+
+void trace_start(void) {
+    for (int c = 0; c < TRACE_MAX_CPUS; ++c) rings[c].written = 0;
+    start_tsc = rdtsc();
+    recording = true;
+}
+
+void trace_stop(void) { recording = false; }
+
+bool trace_active(void) { return recording; }
+
+/*
+ * Format, one event per line after a header:
+ *   #trace v1 cpus=<n> events=<kept> dropped=<overwritten>
+ *   <cpu> <ns since start> <name> <a> <b>      (a and b in hex)
+ *   #end
+ */
+void trace_dump(void) {
+    bool was_recording = recording;
+    recording = false;
+    for (int c = 0; c < TRACE_MAX_CPUS; ++c) {
+        struct trace_ring *ring = &rings[c];
+        uint64_t kept = ring->written < TRACE_RING_EVENTS ? ring->written : TRACE_RING_EVENTS;
+        serial_write("#trace v1 cpus=");
+        serial_write_u32(TRACE_MAX_CPUS);
+        serial_write(" events=");
+        serial_write_u32((uint32_t)kept);
+        serial_write(" dropped=");
+        serial_write_u32((uint32_t)(ring->written - kept));
+        serial_write("\r\n");
+        for (uint64_t i = ring->written - kept; i < ring->written; ++i) {
+            const struct trace_event *ev = &ring->events[i & (TRACE_RING_EVENTS - 1)];
+            serial_write_u32(ev->cpu);
+            serial_write(" ");
+            serial_write_u64(tsc_to_ns(ev->tsc - start_tsc));
+            serial_write(" ");
+            serial_write(ev->id < TRACE_EVENT_COUNT ? trace_names[ev->id] : "?");
+            serial_write(" ");
+            serial_write_hex(ev->a);
+            serial_write(" ");
+            serial_write_hex(ev->b);
+            serial_write("\r\n");
+        }
+        serial_write("#end\r\n");
+    }
+    recording = was_recording;
+}
+
+#else
+
+bool trace_compiled_in(void) { (void)trace_names; return false; }
+void trace_start(void) {}
+void trace_stop(void) {}
+bool trace_active(void) { return false; }
+void trace_dump(void) { serial_write("#trace v1 cpus=0 events=0 dropped=0\r\n#end\r\n"); }
+
+#endif
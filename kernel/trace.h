@@ -0,0 +1,65 @@
+#ifndef AIOS_KERNEL_TRACE_H
+#define AIOS_KERNEL_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Tracepoints: fixed-size binary records in a per-CPU ring, overwritten
+ * oldest-first. Build with AIOS_TRACE=1 (scripts/setup_env.sh) to compile
+ * them in; otherwise TRACE() compiles to nothing and its arguments are not
+ * evaluated. Events ending in _BEGIN/_END pair up into spans on the host
+ * timeline (scripts/trace_timeline.py).
+ */
+
+enum trace_id {
+    TRACE_FS_OP_BEGIN,        /* a: trace_fs_op, b: see below */
+    TRACE_FS_OP_END,          /* a: trace_fs_op, b: rc */
+    TRACE_FS_RESOLVE_BEGIN,   /* a: start inode */
+    TRACE_FS_RESOLVE_END,     /* a: inode, b: rc */
+    TRACE_FS_BITMAP_SYNC,     /* a: first block, b: block count */
+    TRACE_FS_META_FLUSH,      /* superblock + checksum table written */
+    TRACE_BD_READ_BEGIN,      /* a: block */
+    TRACE_BD_READ_END,        /* a: block, b: rc */
+    TRACE_BD_WRITE_BEGIN,     /* a: block */
+    TRACE_BD_WRITE_END,       /* a: block, b: rc */
+    TRACE_VIRTIO_SUBMIT,      /* a: sector, b: write */
+    TRACE_VIRTIO_COMPLETE,    /* a: sector, b: status */
+    TRACE_EVENT_COUNT
+};
+
+/* Argument a of TRACE_FS_OP_BEGIN/END. */
+enum trace_fs_op {
+    TRACE_FS_FORMAT,
+    TRACE_FS_MOUNT,
+    TRACE_FS_MKDIR,
+    TRACE_FS_CREATE,
+    TRACE_FS_DELETE,
+    TRACE_FS_WRITE,  /* b on begin: length */
+    TRACE_FS_READ,   /* b on begin: length */
+    TRACE_FS_LIST,
+};
+
+struct trace_event {
+    uint64_t tsc;
+    uint16_t id;
+    uint16_t cpu;
+    uint32_t reserved;
+    uint64_t a;
+    uint64_t b;
+};
+
+#ifdef AIOS_TRACE
+void trace_emit(uint16_t id, uint64_t a, uint64_t b);
+#define TRACE(id, a, b) trace_emit((uint16_t)(id), (uint64_t)(a), (uint64_t)(b))
+#else
+#define TRACE(id, a, b) ((void)sizeof(a), (void)sizeof(b))
+#endif
+
+bool trace_compiled_in(void);
+void trace_start(void);   /* clears the ring and starts recording */
+void trace_stop(void);
+bool trace_active(void);
+void trace_dump(void);    /* text dump over serial */
+
+#endif
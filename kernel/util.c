@@ -1,22 +1,295 @@
 #include "kernel/util.h"
+#include "kernel/cpu.h"
 
-void *memcpy(void *dest, const void *src, size_t n) {
+/*
+ * memcpy/memset go through function pointers picked once by
+ * string_ops_init(): "rep movsb/stosb" when the CPU advertises ERMS, else
+ * 32-byte AVX loops once cpu_init() has enabled AVX state, else SSE2 loops
+ * (SSE2 is part of x86-64, so the SSE2 versions are also the boot-time
+ * default). Page-aligned whole-page copies, i.e. block transfers,
+ * skip the alignment prologue and tail entirely.
+ */
+
+#define STRING_PAGE 4096u
+
+typedef uint64_t __attribute__((may_alias, aligned(1))) word_t;
+
+static void copy_bytes(uint8_t *d, const uint8_t *s, size_t n) {
+    while (n >= 8) {
+        *(word_t *)d = *(const word_t *)s;
+        d += 8; s += 8; n -= 8;
+    }
+    while (n--) *d++ = *s++;
+}
+
+/* 64 bytes per iteration; d must be 16-byte aligned. */
+static void copy_sse2_blocks(uint8_t *d, const uint8_t *s, size_t blocks) {
+    if (((uintptr_t)s & 15u) == 0) {
+        __asm__ __volatile__(
+            "1:\n\t"
+            "movdqa (%1), %%xmm0\n\t"
+            "movdqa 16(%1), %%xmm1\n\t"
+            "movdqa 32(%1), %%xmm2\n\t"
+            "movdqa 48(%1), %%xmm3\n\t"
+            "movdqa %%xmm0, (%0)\n\t"
+            "movdqa %%xmm1, 16(%0)\n\t"
+            "movdqa %%xmm2, 32(%0)\n\t"
+            "movdqa %%xmm3, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "add $64, %1\n\t"
+            "dec %2\n\t"
+            "jnz 1b"
+            : "+r"(d), "+r"(s), "+r"(blocks)
+            :
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    } else {
+        __asm__ __volatile__(
+            "1:\n\t"
+            "movdqu (%1), %%xmm0\n\t"
+            "movdqu 16(%1), %%xmm1\n\t"
+            "movdqu 32(%1), %%xmm2\n\t"
+            "movdqu 48(%1), %%xmm3\n\t"
+            "movdqa %%xmm0, (%0)\n\t"
+            "movdqa %%xmm1, 16(%0)\n\t"
+            "movdqa %%xmm2, 32(%0)\n\t"
+            "movdqa %%xmm3, 48(%0)\n\t"
+            "add $64, %0\n\t"
+            "add $64, %1\n\t"
+            "dec %2\n\t"
+            "jnz 1b"
+            : "+r"(d), "+r"(s), "+r"(blocks)
+            :
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    }
+}
+
+static void *memcpy_sse2(void *dest, const void *src, size_t n) {
     uint8_t *d = (uint8_t *)dest;
     const uint8_t *s = (const uint8_t *)src;
-    while (n--) {
-        *d++ = *s++;
+    if ((((uintptr_t)d | (uintptr_t)s | n) & (STRING_PAGE - 1)) == 0) {
+        if (n) copy_sse2_blocks(d, s, n / 64u);
+        return dest;
+    }
+    if (n >= 64) {
+        size_t head = (16u - ((uintptr_t)d & 15u)) & 15u;
+        copy_bytes(d, s, head);
+        d += head; s += head; n -= head;
+        size_t blocks = n / 64u;
+        if (blocks) copy_sse2_blocks(d, s, blocks);
+        d += blocks * 64u; s += blocks * 64u; n %= 64u;
+    }
+    copy_bytes(d, s, n);
+    return dest;
+}
+
+/* 128 bytes per iteration; d must be 32-byte aligned. */
+static void copy_avx_blocks(uint8_t *d, const uint8_t *s, size_t blocks) {
+    __asm__ __volatile__(
+        "1:\n\t"
+        "vmovdqu (%1), %%ymm0\n\t"
+        "vmovdqu 32(%1), %%ymm1\n\t"
+        "vmovdqu 64(%1), %%ymm2\n\t"
+        "vmovdqu 96(%1), %%ymm3\n\t"
+        "vmovdqa %%ymm0, (%0)\n\t"
+        "vmovdqa %%ymm1, 32(%0)\n\t"
+        "vmovdqa %%ymm2, 64(%0)\n\t"
+        "vmovdqa %%ymm3, 96(%0)\n\t"
+        "add $128, %0\n\t"
+        "add $128, %1\n\t"
+        "dec %2\n\t"
+        "jnz 1b\n\t"
+        "vzeroupper"
+        : "+r"(d), "+r"(s), "+r"(blocks)
+        :
+        : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+}
+
+static void *memcpy_avx(void *dest, const void *src, size_t n) {
+    uint8_t *d = (uint8_t *)dest;
+    const uint8_t *s = (const uint8_t *)src;
+    if ((((uintptr_t)d | (uintptr_t)s | n) & (STRING_PAGE - 1)) == 0) {
+        if (n) copy_avx_blocks(d, s, n / 128u);
+        return dest;
+    }
+    if (n >= 128) {
+        size_t head = (32u - ((uintptr_t)d & 31u)) & 31u;
+        copy_bytes(d, s, head);
+        d += head; s += head; n -= head;
+        size_t blocks = n / 128u;
+        if (blocks) copy_avx_blocks(d, s, blocks);
+        d += blocks * 128u; s += blocks * 128u; n %= 128u;
+    }
+    copy_bytes(d, s, n);
+    return dest;
+}
+
+static void *memcpy_erms(void *dest, const void *src, size_t n) {
+    void *d = dest;
+    __asm__ __volatile__("rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dest;
+}
+
+static void set_bytes(uint8_t *d, uint8_t value, size_t n) {
+    uint64_t pattern = value * 0x0101010101010101ull;
+    while (n >= 8) {
+        *(word_t *)d = pattern;
+        d += 8; n -= 8;
+    }
+    while (n--) *d++ = value;
+}
+
+static void *memset_sse2(void *dest, int value, size_t n) {
+    uint8_t *d = (uint8_t *)dest;
+    uint8_t v = (uint8_t)value;
+    if (n >= 64) {
+        size_t head = (16u - ((uintptr_t)d & 15u)) & 15u;
+        set_bytes(d, v, head);
+        d += head; n -= head;
+        size_t blocks = n / 64u;
+        if (blocks) {
+            uint64_t pattern = v * 0x0101010101010101ull;
+            __asm__ __volatile__(
+                "movq %3, %%xmm0\n\t"
+                "punpcklqdq %%xmm0, %%xmm0\n\t"
+                "1:\n\t"
+                "movdqa %%xmm0, (%0)\n\t"
+                "movdqa %%xmm0, 16(%0)\n\t"
+                "movdqa %%xmm0, 32(%0)\n\t"
+                "movdqa %%xmm0, 48(%0)\n\t"
+                "add $64, %0\n\t"
+                "dec %1\n\t"
+                "jnz 1b"
+                : "=r"(d), "=r"(blocks)
+                : "0"(d), "r"(pattern), "1"(blocks)
+                : "memory", "xmm0");
+        }
+        n %= 64u;
     }
+    set_bytes(d, v, n);
     return dest;
 }
 
+static void *memset_avx(void *dest, int value, size_t n) {
+    uint8_t *d = (uint8_t *)dest;
+    uint8_t v = (uint8_t)value;
+    if (n >= 128) {
+        size_t head = (32u - ((uintptr_t)d & 31u)) & 31u;
+        set_bytes(d, v, head);
+        d += head; n -= head;
+        size_t blocks = n / 128u;
+        if (blocks) {
+            uint64_t pattern = v * 0x0101010101010101ull;
+            __asm__ __volatile__(
+                "vmovq %3, %%xmm0\n\t"
+                "vpunpcklqdq %%xmm0, %%xmm0, %%xmm0\n\t"
+                "vinsertf128 $1, %%xmm0, %%ymm0, %%ymm0\n\t"
+                "1:\n\t"
+                "vmovdqa %%ymm0, (%0)\n\t"
+                "vmovdqa %%ymm0, 32(%0)\n\t"
+                "vmovdqa %%ymm0, 64(%0)\n\t"
+                "vmovdqa %%ymm0, 96(%0)\n\t"
+                "add $128, %0\n\t"
+                "dec %1\n\t"
+                "jnz 1b\n\t"
+                "vzeroupper"
+                : "=r"(d), "=r"(blocks)
+                : "0"(d), "r"(pattern), "1"(blocks)
+                : "memory", "xmm0");
+        }
+        n %= 128u;
+    }
+    set_bytes(d, v, n);
+    return dest;
+}
+
+static void *memset_erms(void *dest, int value, size_t n) {
+    void *d = dest;
+    __asm__ __volatile__("rep stosb" : "+D"(d), "+c"(n) : "a"((uint8_t)value) : "memory");
+    return dest;
+}
+
+static void *(*memcpy_impl)(void *, const void *, size_t) = memcpy_sse2;
+static void *(*memset_impl)(void *, int, size_t) = memset_sse2;
+static const char *string_ops = "sse2";
+
+void string_ops_init(void) {
+    const struct cpu_features *cpu = cpu_get_features();
+    if (cpu->erms || cpu->fsrm) {
+        memcpy_impl = memcpy_erms;
+        memset_impl = memset_erms;
+        string_ops = cpu->fsrm ? "erms+fsrm" : "erms";
+    } else if (cpu->avx_enabled) {
+        memcpy_impl = memcpy_avx;
+        memset_impl = memset_avx;
+        string_ops = "avx";
+    }
+}
+
+const char *string_ops_name(void) {
+    return string_ops;
+}
+
+void *memcpy(void *dest, const void *src, size_t n) {
+    return memcpy_impl(dest, src, n);
+}
+
 void *memset(void *dest, int value, size_t n) {
+    return memset_impl(dest, value, n);
+}
+
+void *memmove(void *dest, const void *src, size_t n) {
     uint8_t *d = (uint8_t *)dest;
-    while (n--) {
-        *d++ = (uint8_t)value;
+    const uint8_t *s = (const uint8_t *)src;
+    if (d <= s || d >= s + n) return memcpy_impl(dest, src, n);
+    d += n; s += n;
+    while (n >= 8) {
+        d -= 8; s -= 8; n -= 8;
+        *(word_t *)d = *(const word_t *)s;
     }
+    while (n--) *--d = *--s;
     return dest;
 }
 
+int memcmp(const void *a, const void *b, size_t n) {
+    const uint8_t *x = (const uint8_t *)a;
+    const uint8_t *y = (const uint8_t *)b;
+    while (n >= 8 && *(const word_t *)x == *(const word_t *)y) {
+        x += 8; y += 8; n -= 8;
+    }
+    for (; n; --n, ++x, ++y) {
+        if (*x != *y) return (int)*x - (int)*y;
+    }
+    return 0;
+}
+
+void memzero_nt(void *dest, size_t n) {
+    uint8_t *d = (uint8_t *)dest;
+    while (n && ((uintptr_t)d & 7u)) {
+        *d++ = 0;
+        n--;
+    }
+    size_t chunks = n / 32u;
+    if (chunks) {
+        __asm__ __volatile__(
+            "1:\n\t"
+            "movnti %%rax, (%0)\n\t"
+            "movnti %%rax, 8(%0)\n\t"
+            "movnti %%rax, 16(%0)\n\t"
+            "movnti %%rax, 24(%0)\n\t"
+            "add $32, %0\n\t"
+            "dec %1\n\t"
+            "jnz 1b\n\t"
+            "sfence"
+            : "+r"(d), "+r"(chunks)
+            : "a"(0ull)
+            : "memory");
+    }
+    n %= 32u;
+    while (n--) {
+        *d++ = 0;
+    }
+}
+
 size_t strlen(const char *s) {
     size_t len = 0;
     while (s && *s++) {
@@ -6,6 +6,12 @@
 
 void *memcpy(void *dest, const void *src, size_t n);
 void *memset(void *dest, int value, size_t n);
+void *memmove(void *dest, const void *src, size_t n);
+int memcmp(const void *a, const void *b, size_t n);
+void memzero_nt(void *dest, size_t n); /* non-temporal; bypasses the cache */
+/* Pick memcpy/memset implementations for this CPU; needs cpu_init(). */
+void string_ops_init(void);
+const char *string_ops_name(void);
 size_t strlen(const char *s);
 int strcmp(const char *a, const char *b);
 int strncmp(const char *a, const char *b, size_t n);
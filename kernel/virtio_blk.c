@@ -1,14 +1,19 @@
 #include "virtio_blk.h"
 #include "io.h"
 #include "mem.h"
+#include "pmm.h"
+#include "slab.h"
+#include "time.h"
+#include "trace.h"
 #include "util.h"
 #include <stddef.h>
 
 #define PCI_CONFIG_ADDRESS 0xCF8
 #define PCI_CONFIG_DATA    0xCFC
 
-#define VIRTQ_NUM 8
 #define VIRTIO_SECTOR_SIZE 512u
+#define VIRTIO_QUEUE_ALIGN 4096u
+#define VIRTIO_TIMEOUT_MS 5000u /* per request; generous enough for TCG */
 
 #define VIRTIO_VENDOR 0x1AF4
 #define VIRTIO_DEVICE_BLK 0x1001
@@ -43,8 +48,7 @@ struct virtq_desc {
 struct virtq_avail {
     uint16_t flags;
     uint16_t idx;
-    uint16_t ring[VIRTQ_NUM];
-    uint16_t used_event;
+    uint16_t ring[]; /* queue_size entries, then used_event */
 };
 
 struct virtq_used_elem {
@@ -55,8 +59,7 @@ struct virtq_used_elem {
 struct virtq_used {
     uint16_t flags;
     uint16_t idx;
-    struct virtq_used_elem ring[VIRTQ_NUM];
-    uint16_t avail_event;
+    struct virtq_used_elem ring[]; /* queue_size entries, then avail_event */
 };
 
 struct virtio_blk_req {
@@ -65,6 +68,14 @@ struct virtio_blk_req {
     uint64_t sector;
 };
 
+/* Request header and status byte share one cache-line-aligned object. */
+struct virtio_blk_cmd {
+    struct virtio_blk_req req;
+    uint8_t status;
+};
+
+static struct slab_cache *cmd_cache = NULL;
+
 struct virtio_blk_queue {
     struct virtq_desc *desc;
     struct virtq_avail *avail;
@@ -130,21 +141,22 @@ static int virtio_setup_queue(struct virtio_blk *dev) {
     queue_select(dev->iobase, 0);
     uint16_t qsz = queue_size(dev->iobase);
     if (qsz == 0) return -1;
-    if (qsz > VIRTQ_NUM) qsz = VIRTQ_NUM;
+    /* Legacy devices fix the ring size, so size the ring to match. */
     dev->queue_size = qsz;
 
-    size_t alloc = sizeof(struct virtq_desc) * qsz +
-                   sizeof(struct virtq_avail) +
-                   sizeof(struct virtq_used);
-    void *mem = kalloc_aligned(alloc, 0x1000);
+    /* Legacy layout: descriptors, avail ring, then the used ring on the next
+     * VIRTIO_QUEUE_ALIGN boundary. [Virtio 0.9.5 §2.3 Virtqueues] */
+    size_t desc_bytes = sizeof(struct virtq_desc) * qsz;
+    size_t avail_bytes = sizeof(uint16_t) * (3u + qsz);
+    size_t used_offset = (desc_bytes + avail_bytes + VIRTIO_QUEUE_ALIGN - 1) & ~((size_t)VIRTIO_QUEUE_ALIGN - 1);
+    size_t used_bytes = sizeof(uint16_t) * 3u + sizeof(struct virtq_used_elem) * qsz;
+    unsigned order = pmm_order_for(used_offset + used_bytes);
+    void *mem = pmm_alloc_zeroed_pages(order);
     if (!mem) return -1;
-    memset(mem, 0, alloc);
 
     dev->desc = (struct virtq_desc *)mem;
-    dev->avail = (struct virtq_avail *)((uint8_t *)dev->desc + sizeof(struct virtq_desc) * qsz);
-    uintptr_t used_ptr = (uintptr_t)(dev->avail + 1);
-    used_ptr = (used_ptr + 3) & ~((uintptr_t)3);
-    dev->used = (struct virtq_used *)used_ptr;
+    dev->avail = (struct virtq_avail *)((uint8_t *)mem + desc_bytes);
+    dev->used = (struct virtq_used *)((uint8_t *)mem + used_offset);
     dev->used_idx = 0;
 
     uintptr_t phys = (uintptr_t)dev->desc;
@@ -196,9 +208,11 @@ int virtio_blk_init(struct virtio_blk *dev) {
         return -1;
     }
 
-    dev->request = (struct virtio_blk_req *)kalloc(sizeof(struct virtio_blk_req));
-    dev->status = (uint8_t *)kalloc(1);
-    if (!dev->request || !dev->status) return -1;
+    if (!cmd_cache) cmd_cache = slab_cache_create("virtio-blk-cmd", sizeof(struct virtio_blk_cmd), 0, NULL);
+    struct virtio_blk_cmd *cmd = cmd_cache ? (struct virtio_blk_cmd *)slab_alloc(cmd_cache) : NULL;
+    if (!cmd) return -1;
+    dev->request = &cmd->req;
+    dev->status = &cmd->status;
 
     dev->capacity_sectors = read_capacity(iobase);
     write_status(iobase, read_status(iobase) | VIRTIO_STATUS_DRIVER_OK);
@@ -206,6 +220,7 @@ int virtio_blk_init(struct virtio_blk *dev) {
 }
 
 static int virtio_blk_submit(struct virtio_blk *dev, uint32_t type, uint64_t sector, void *buf, uint32_t sectors, int write) {
+    uint64_t start = ktime_ns();
     uint16_t idx = dev->avail->idx % dev->queue_size;
     struct virtio_blk_req *req = dev->request;
     req->type = type;
@@ -230,20 +245,29 @@ static int virtio_blk_submit(struct virtio_blk *dev, uint32_t type, uint64_t sec
 
     dev->avail->ring[idx] = 0;
     dev->avail->idx++;
+    dev->stats.submits++;
+    TRACE(TRACE_VIRTIO_SUBMIT, sector, write);
     queue_notify(dev->iobase, 0);
+    uint64_t notified = ktime_ns();
+    hist_add(&dev->stats.submit_lat, notified - start);
 
-    uint32_t spin = 0;
-    const uint32_t spin_limit = 1u << 24;
+    uint64_t deadline = notified + VIRTIO_TIMEOUT_MS * NSEC_PER_MSEC;
     while (dev->used->idx == dev->used_idx) {
         uint8_t isr = inb_port(dev->iobase + VIRTIO_REG_ISR_STATUS);
         if (isr & 0x1) break;
-        if (++spin >= spin_limit) {
+        if (ktime_ns() > deadline) {
+            dev->stats.timeouts++;
+            TRACE(TRACE_VIRTIO_COMPLETE, sector, 0xFF);
             return -1;
         }
+        dev->stats.spins++;
         __asm__ __volatile__("pause");
     }
     dev->used_idx = dev->used->idx;
+    hist_add(&dev->stats.device_lat, ktime_ns() - notified);
+    TRACE(TRACE_VIRTIO_COMPLETE, sector, *dev->status);
     if (*dev->status != 0) {
+        dev->stats.errors++;
         return -1;
     }
     return 0;
@@ -277,13 +301,20 @@ static int virtio_write_block(struct blockdev *bd, uint32_t block, const void *b
 int bd_init_virtio(struct blockdev *bd, struct virtio_blk *dev, uint32_t block_size) {
     if (block_size % VIRTIO_SECTOR_SIZE != 0) return -1;
     struct virtio_block_ctx *ctx = (struct virtio_block_ctx *)kalloc(sizeof(struct virtio_block_ctx));
-    if (!ctx) return -1;
+    struct bd_stats *stats = (struct bd_stats *)kcalloc(1, sizeof(struct bd_stats));
+    if (!ctx || !stats) {
+        kfree(ctx);
+        kfree(stats);
+        return -1;
+    }
     ctx->dev = dev;
     ctx->sectors_per_block = block_size / VIRTIO_SECTOR_SIZE;
     bd->ctx = ctx;
+    bd->stats = stats;
     bd->block_size = block_size;
     bd->blocks = dev->capacity_sectors / ctx->sectors_per_block;
     bd->read_fn = virtio_read_block;
     bd->write_fn = virtio_write_block;
+    bd->zero_fn = NULL;
     return 0;
 }
@@ -3,12 +3,22 @@
 
 #include <stdint.h>
 #include "fs/blockdev.h"
+#include "hist.h"
 
 struct virtq_desc;
 struct virtq_avail;
 struct virtq_used;
 struct virtio_blk_req;
 
+struct virtio_blk_stats {
+    uint64_t submits;
+    uint64_t spins;    /* completion polls that found nothing yet */
+    uint64_t timeouts;
+    uint64_t errors;   /* device returned a non-zero status */
+    struct hist submit_lat; /* descriptor setup through the notify write */
+    struct hist device_lat; /* notify until the completion is seen */
+};
+
 struct virtio_blk {
     uint8_t bus;
     uint8_t device;
@@ -25,6 +35,7 @@ struct virtio_blk {
 
     struct virtio_blk_req *request;
     uint8_t *status;
+    struct virtio_blk_stats stats;
 };
 
 int virtio_blk_init(struct virtio_blk *dev);
@@ -0,0 +1,206 @@
+#!/usr/bin/env python3
+"""Boot AIOS headless under QEMU, drive the serial shell, and time it.
+
+Usage: qemu_bench.py --out report.json [--log serial.log] [--script cmds.txt]
+                     [--boot-timeout S] [--cmd-timeout S] -- <qemu command ...>
+
+The QEMU command must route the guest serial port to stdio (-serial stdio)
+with no monitor on it. The driver waits for the first `aios-fs:...>` prompt,
+then sends each script command and waits for the next prompt, recording
+wall time per command. A script line of the form
+
+    write <file> <lines> <width>
+
+sends `write <file>` followed by <lines> generated lines of <width>
+characters and the terminating ".". Lines starting with '#' are ignored.
+
+The JSON report holds time-to-prompt, the kernel's boot timeline, per-command
+wall times and whether each command reported a failure.
+"""
+import argparse
+import json
+import os
+import re
+import select
+import subprocess
+import sys
+import time
+
+PROMPT = re.compile(rb"aios-fs:[^\r\n>]*> ")
+FAILURE = re.compile(rb"failed|Unknown command|usage:|not found|out of memory")
+TIMELINE_LINE = re.compile(r"^\s+(\d+\.\d+)\s+\+(\d+\.\d+)\s+(.+?)\s*$")
+
+DEFAULT_SCRIPT = """\
+# fresh disk every run
+format-disk
+sysinfo storage
+make-dir data
+write data/small 4 32
+write data/medium 64 60
+write data/large 400 60
+write data/f0 16 60
+write data/f1 16 60
+write data/f2 16 60
+write data/f3 16 60
+list data
+read data/small
+read data/medium
+read data/large
+read data/f0
+read data/f3
+delete data/f0
+delete data/f1
+delete data/f2
+delete data/f3
+list data
+bench fs 32
+bench heap
+sysinfo latency
+sysinfo stats
+"""
+
+
+class Guest:
+    def __init__(self, cmd, log):
+        self.start = time.monotonic()
+        self.proc = subprocess.Popen(cmd, stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, bufsize=0)
+        self.log = log
+        self.buf = b""
+
+    def _read(self, deadline):
+        remaining = deadline - time.monotonic()
+        if remaining <= 0:
+            return False
+        ready, _, _ = select.select([self.proc.stdout], [], [], min(remaining, 0.5))
+        if not ready:
+            return self.proc.poll() is None
+        chunk = os.read(self.proc.stdout.fileno(), 65536)
+        if not chunk:
+            return False
+        self.buf += chunk
+        if self.log:
+            self.log.write(chunk)
+            self.log.flush()
+        return True
+
+    def wait_prompt(self, timeout):
+        """Returns output up to and including the next prompt, or None on timeout/exit."""
+        deadline = time.monotonic() + timeout
+        while True:
+            m = PROMPT.search(self.buf)
+            if m:
+                out = self.buf[:m.end()]
+                self.buf = self.buf[m.end():]
+                return out
+            if not self._read(deadline):
+                return None
+
+    def send(self, text):
+        self.proc.stdin.write(text.encode())
+        self.proc.stdin.flush()
+
+    def close(self):
+        if self.proc.poll() is None:
+            self.proc.terminate()
+            try:
+                self.proc.wait(timeout=5)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+
+
+def expand(line):
+    """Turns a script line into (label, text to send)."""
+    parts = line.split()
+    if parts[0] == "write" and len(parts) == 4:
+        name, lines, width = parts[1], int(parts[2]), int(parts[3])
+        body = "".join("%0*d\r" % (width, i) for i in range(lines))
+        return "write %s (%d lines)" % (name, lines), "write %s\r%s.\r" % (name, body)
+    return line, line + "\r"
+
+
+def parse_timeline(text):
+    steps = []
+    in_timeline = False
+    for line in text.splitlines():
+        if "Boot timeline" in line:
+            in_timeline = True
+            continue
+        if not in_timeline:
+            continue
+        m = TIMELINE_LINE.match(line)
+        if not m:
+            if steps:
+                break
+            continue
+        steps.append({"phase": m.group(3), "at_ms": float(m.group(1)), "took_ms": float(m.group(2))})
+    return steps
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--out", required=True)
+    ap.add_argument("--log")
+    ap.add_argument("--script")
+    ap.add_argument("--boot-timeout", type=float, default=300.0)
+    ap.add_argument("--cmd-timeout", type=float, default=300.0)
+    ap.add_argument("qemu", nargs=argparse.REMAINDER)
+    args = ap.parse_args()
+    qemu = args.qemu[1:] if args.qemu[:1] == ["--"] else args.qemu
+    if not qemu:
+        ap.error("missing QEMU command after --")
+
+    script = DEFAULT_SCRIPT
+    if args.script:
+        with open(args.script) as f:
+            script = f.read()
+    commands = [l.strip() for l in script.splitlines() if l.strip() and not l.strip().startswith("#")]
+
+    log = open(args.log, "wb") if args.log else None
+    guest = Guest(qemu, log)
+    report = {"version": 1, "qemu": qemu, "commands": [], "ok": False}
+    try:
+        boot = guest.wait_prompt(args.boot_timeout)
+        if boot is None:
+            report["error"] = "no shell prompt within %.0f s" % args.boot_timeout
+            return finish(report, args.out, 1)
+        report["time_to_prompt_s"] = round(time.monotonic() - guest.start, 3)
+        report["boot_timeline"] = parse_timeline(boot.decode(errors="replace"))
+
+        ok = True
+        for line in commands:
+            label, text = expand(line)
+            t0 = time.monotonic()
+            guest.send(text)
+            out = guest.wait_prompt(args.cmd_timeout)
+            wall = time.monotonic() - t0
+            entry = {"cmd": label, "wall_s": round(wall, 4)}
+            if out is None:
+                entry["ok"] = False
+                entry["error"] = "timeout"
+                report["commands"].append(entry)
+                ok = False
+                break
+            entry["ok"] = FAILURE.search(out) is None
+            ok = ok and entry["ok"]
+            report["commands"].append(entry)
+            print("%-32s %8.3f s%s" % (label, wall, "" if entry["ok"] else "  FAILED"), file=sys.stderr)
+        report["total_command_s"] = round(sum(c["wall_s"] for c in report["commands"]), 3)
+        report["ok"] = ok
+        return finish(report, args.out, 0 if ok else 1)
+    finally:
+        guest.close()
+        if log:
+            log.close()
+
+
+def finish(report, path, rc):
+    with open(path, "w") as f:
+        json.dump(report, f, indent=2)
+        f.write("\n")
+    print("report: %s" % path, file=sys.stderr)
+    return rc
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -11,6 +11,7 @@ IMAGE_PATH="$IMAGE_DIR/aios-efi.img"
 IMAGE_SIZE="${IMAGE_SIZE:-64M}"
 DATA_IMAGE="$IMAGE_DIR/aios-data.img"
 DATA_IMAGE_SIZE="${DATA_IMAGE_SIZE:-32M}"
+AIOS_TRACE="${AIOS_TRACE:-0}" # 1 compiles kernel tracepoints in (see kernel/trace.h)
 EFI_BINARY="$ESP_STAGING/EFI/BOOT/BOOTX64.EFI" # UEFI removable-media fallback. Spec §3.5.1.
 KERNEL_BINARY="$ESP_STAGING/AIOS/KERNEL.ELF"
 KERNEL_ELF="$KERNEL_BUILD_DIR/kernel.elf"
@@ -161,6 +162,7 @@ build_kernel() {
         -mno-red-zone
         -m64
         -mcmodel=large
+        -fno-omit-frame-pointer
         -Wall
         -Wextra
         -Werror
@@ -170,28 +172,84 @@ build_kernel() {
         -I"$PROJECT_ROOT/kernel"
         -I"$PROJECT_ROOT/kernel/fs"
     )
+    if [[ "$AIOS_TRACE" == "1" ]]; then
+        cflags+=(-DAIOS_TRACE)
+    fi
 
     local objs=()
     for src in \
         "$PROJECT_ROOT/kernel/main.c" \
         "$PROJECT_ROOT/kernel/serial.c" \
+        "$PROJECT_ROOT/kernel/boottime.c" \
+        "$PROJECT_ROOT/kernel/cpu.c" \
+        "$PROJECT_ROOT/kernel/idt.c" \
+        "$PROJECT_ROOT/kernel/isr.S" \
+        "$PROJECT_ROOT/kernel/lapic.c" \
+        "$PROJECT_ROOT/kernel/acpi.c" \
+        "$PROJECT_ROOT/kernel/ioapic.c" \
+        "$PROJECT_ROOT/kernel/irq.c" \
+        "$PROJECT_ROOT/kernel/idle.c" \
+        "$PROJECT_ROOT/kernel/thread.c" \
+        "$PROJECT_ROOT/kernel/switch.S" \
+        "$PROJECT_ROOT/kernel/ksyms.c" \
+        "$PROJECT_ROOT/kernel/profile.c" \
+        "$PROJECT_ROOT/kernel/crc32c.c" \
+        "$PROJECT_ROOT/kernel/time.c" \
+        "$PROJECT_ROOT/kernel/hist.c" \
+        "$PROJECT_ROOT/kernel/trace.c" \
+        "$PROJECT_ROOT/kernel/fsrec.c" \
         "$PROJECT_ROOT/kernel/util.c" \
         "$PROJECT_ROOT/kernel/mem.c" \
+        "$PROJECT_ROOT/kernel/pmm.c" \
+        "$PROJECT_ROOT/kernel/paging.c" \
+        "$PROJECT_ROOT/kernel/slab.c" \
+        "$PROJECT_ROOT/kernel/arena.c" \
         "$PROJECT_ROOT/kernel/fs/blockdev.c" \
         "$PROJECT_ROOT/kernel/fs/fs.c" \
         "$PROJECT_ROOT/kernel/shell.c" \
+        "$PROJECT_ROOT/kernel/bench.c" \
         "$PROJECT_ROOT/kernel/virtio_blk.c"; do
         local obj="$KERNEL_BUILD_DIR/$(basename "${src%.*}").o"
         x86_64-linux-gnu-gcc "${cflags[@]}" -c "$src" -o "$obj"
         objs+=("$obj")
     done
 
+    # Two passes: link with an empty symbol table, then generate the table
+    # from that image and relink. The table only adds .rodata, which the
+    # linker script places after .text, so code addresses do not move.
+    local ksyms_src="$KERNEL_BUILD_DIR/ksyms_table.c"
+    local ksyms_obj="$KERNEL_BUILD_DIR/ksyms_table.o"
+    local text_syms="$KERNEL_BUILD_DIR/kernel.syms"
+    gen_ksyms /dev/null >"$ksyms_src"
+    x86_64-linux-gnu-gcc "${cflags[@]}" -c "$ksyms_src" -o "$ksyms_obj"
+    link_kernel "${objs[@]}" "$ksyms_obj"
+
+    x86_64-linux-gnu-nm -n --defined-only "$KERNEL_ELF" | awk '$2 ~ /^[tT]$/' >"$text_syms"
+    gen_ksyms "$text_syms" >"$ksyms_src"
+    x86_64-linux-gnu-gcc "${cflags[@]}" -c "$ksyms_src" -o "$ksyms_obj"
+    link_kernel "${objs[@]}" "$ksyms_obj"
+    if ! x86_64-linux-gnu-nm -n --defined-only "$KERNEL_ELF" | awk '$2 ~ /^[tT]$/' | cmp -s - "$text_syms"; then
+        echo "Kernel text moved between link passes; symbol table would be wrong" >&2
+        exit 1
+    fi
+}
+
+link_kernel() {
     x86_64-linux-gnu-ld \
         -nostdlib \
         -z max-page-size=0x1000 \
         -T "$PROJECT_ROOT/kernel/link.ld" \
         -o "$KERNEL_ELF" \
-        "${objs[@]}"
+        "$@"
+}
+
+# C source for ksym_table (kernel/ksyms.h) from `nm -n` text symbol lines.
+gen_ksyms() {
+    awk '
+        BEGIN { print "#include \"ksyms.h\""; print "const struct ksym ksym_table[] = {" }
+        $3 !~ /^__text_(start|end)$/ { printf "    {0x%s, \"%s\"},\n", $1, $3; n++ }
+        END { if (n == 0) print "    {0, 0},"; print "};"; printf "const uint32_t ksym_count = %d;\n", n }
+    ' "$1"
 }
 
 create_image() {
@@ -234,6 +292,21 @@ prepare_ovmf_vars() {
     fi
 }
 
+# Fills QEMU_ARGS for the given accel/cpu and virtio data disk image.
+qemu_args() {
+    local accel="$1" cpu="$2" data_image="$3"
+    QEMU_ARGS=(
+        -machine q35,accel=$accel
+        -cpu $cpu
+        -m 512
+        -drive if=pflash,format=raw,readonly=on,file="$OVMF_CODE"
+        -drive if=pflash,format=raw,file="$OVMF_VARS"
+        -drive if=ide,format=raw,file="$IMAGE_PATH"
+        -drive if=none,format=raw,file="$data_image",id=aiosdata
+        -device virtio-blk-pci,drive=aiosdata,disable-modern=on
+    )
+}
+
 run_qemu() {
     if [[ ! -f "$IMAGE_PATH" ]]; then
         echo "Disk image missing at $IMAGE_PATH. Run '$0 image' first." >&2
@@ -252,16 +325,38 @@ run_qemu() {
     # TianoCore's OVMF firmware emulates a UEFI board so we can validate the
     # firmware->bootloader contract in QEMU before hardware trials. [OVMF —
     # https://github.com/tianocore/tianocore.github.io/wiki/OVMF]
-    qemu-system-x86_64 \
-        -machine q35,accel=$accel \
-        -cpu $cpu \
-        -m 512 \
-        -drive if=pflash,format=raw,readonly=on,file="$OVMF_CODE" \
-        -drive if=pflash,format=raw,file="$OVMF_VARS" \
-        -drive if=ide,format=raw,file="$IMAGE_PATH" \
-        -drive if=none,format=raw,file="$DATA_IMAGE",id=aiosdata \
-        -device virtio-blk-pci,drive=aiosdata,disable-modern=on \
-        -serial stdio
+    qemu_args "$accel" "$cpu" "$DATA_IMAGE"
+    qemu-system-x86_64 "${QEMU_ARGS[@]}" -serial stdio
+}
+
+# Boots headless on a scratch data disk and times a fixed shell script.
+# Defaults to TCG so numbers are comparable across hosts; BENCH_ACCEL=kvm
+# opts into hardware acceleration.
+run_bench() {
+    if [[ ! -f "$IMAGE_PATH" ]]; then
+        echo "Disk image missing at $IMAGE_PATH. Run '$0 image' first." >&2
+        exit 1
+    fi
+    prepare_ovmf_vars
+
+    local accel="${BENCH_ACCEL:-tcg}"
+    local cpu="qemu64"
+    [[ "$accel" == "kvm" ]] && cpu="host"
+    local data_image="$BUILD_DIR/bench-data.img"
+    local report="${BENCH_REPORT:-$BUILD_DIR/bench-report.json}"
+    local script_args=()
+    [[ -n "${BENCH_SCRIPT:-}" ]] && script_args=(--script "$BENCH_SCRIPT")
+
+    rm -f "$data_image"
+    truncate -s "$DATA_IMAGE_SIZE" "$data_image"
+
+    log "Benchmarking boot and shell under $accel"
+    qemu_args "$accel" "$cpu" "$data_image"
+    python3 "$PROJECT_ROOT/scripts/qemu_bench.py" \
+        --out "$report" \
+        --log "$BUILD_DIR/bench-serial.log" \
+        ${script_args[@]+"${script_args[@]}"} \
+        -- qemu-system-x86_64 "${QEMU_ARGS[@]}" -display none -monitor none -serial stdio
 }
 
 clean_build() {
@@ -279,6 +374,8 @@ Commands:
   build    Compile the UEFI loader and ELF kernel.
   image    Build loader+kernel (if needed) and generate the FAT32 disk image.
   run      Launch QEMU/OVMF using the generated disk image.
+  bench    Build the image, boot it headless and time a scripted shell session
+           (BENCH_ACCEL=tcg|kvm, BENCH_REPORT=<json>, BENCH_SCRIPT=<file>).
   all      deps -> build -> image -> run (default when no command is given).
   clean    Remove build artifacts and disk images.
   help     Show this message.
@@ -303,6 +400,12 @@ main() {
         run)
             run_qemu
             ;;
+        bench)
+            build_loader
+            build_kernel
+            create_image
+            run_bench
+            ;;
         all)
             install_deps
             build_loader
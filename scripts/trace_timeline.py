@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""Convert an AIOS `trace dump` from a serial log into a Chrome trace file.
+
+Usage: trace_timeline.py <serial.log> [out.json]
+
+Open the result in chrome://tracing or https://ui.perfetto.dev. Events named
+"*.b" / "*.e" become begin/end spans; everything else is an instant event.
+"""
+import json
+import sys
+
+FS_OPS = ["format", "mount", "mkdir", "create", "delete", "write", "read", "list"]
+
+
+def parse(lines):
+    events = []
+    in_dump = False
+    for raw in lines:
+        line = raw.strip()
+        if line.startswith("#trace"):
+            in_dump = True
+            events = []  # keep only the last dump in the log
+            continue
+        if line == "#end":
+            in_dump = False
+            continue
+        if not in_dump:
+            continue
+        parts = line.split()
+        if len(parts) != 5:
+            continue
+        cpu, ns, name, a, b = parts
+        events.append((int(cpu), int(ns), name, int(a, 16), int(b, 16)))
+    return events
+
+
+def to_chrome(events):
+    out = []
+    for cpu, ns, name, a, b in events:
+        phase = "i"
+        label = name
+        if name.endswith(".b") or name.endswith(".e"):
+            phase = "B" if name.endswith(".b") else "E"
+            label = name[:-2]
+        if label == "fs.op" and a < len(FS_OPS):
+            label = "fs." + FS_OPS[a]
+        ev = {"name": label, "ph": phase, "ts": ns / 1000.0, "pid": 0, "tid": cpu,
+              "args": {"a": a, "b": b}}
+        if phase == "i":
+            ev["s"] = "t"
+        out.append(ev)
+    return {"traceEvents": out, "displayTimeUnit": "ns"}
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 1
+    with open(sys.argv[1], errors="replace") as f:
+        events = parse(f)
+    if not events:
+        print("no trace dump found in " + sys.argv[1], file=sys.stderr)
+        return 1
+    out_path = sys.argv[2] if len(sys.argv) > 2 else "trace.json"
+    with open(out_path, "w") as f:
+        json.dump(to_chrome(events), f)
+    print("wrote %d events to %s" % (len(events), out_path))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())